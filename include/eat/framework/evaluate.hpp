@@ -1,5 +1,6 @@
 #pragma once
 #include "process.hpp"
+#include "profile.hpp"
 
 namespace eat::framework {
 
@@ -22,9 +23,17 @@ class ExecStep {
 using ExecStepPtr = std::shared_ptr<ExecStep>;
 
 /// a plan for evaluating a graph
+///
+/// as well as the steps, this holds the dependencies between them:
+/// dependencies()[i] contains the indices of steps which must have been ran
+/// before step i. steps always depend only on earlier steps, so running them in
+/// order is always valid
 class Plan {
  public:
-  Plan(Graph graph, std::vector<ExecStepPtr> steps) : graph_(std::move(graph)), steps_(std::move(steps)) {}
+  /// make a plan where each step depends on the previous one
+  Plan(Graph graph, std::vector<ExecStepPtr> steps);
+
+  Plan(Graph graph, std::vector<ExecStepPtr> steps, std::vector<std::vector<size_t>> dependencies);
 
   /// get the actual graph that will be evaluated
   ///
@@ -34,21 +43,62 @@ class Plan {
   /// get the steps in the plan
   const std::vector<ExecStepPtr> &steps() const { return steps_; }
 
+  /// get the indices of the steps that each step depends on
+  const std::vector<std::vector<size_t>> &dependencies() const { return dependencies_; }
+
   /// run all steps in the plan
   void run() {
-    for (auto &step : steps_) step->run();
+    for (size_t i = 0; i < steps_.size(); i++) profile_call(step_profile(i), [&]() { steps_[i]->run(); });
   }
 
+  /// run the steps in the plan using n_threads threads
+  ///
+  /// each step is started once all steps it depends on have finished, so
+  /// independent steps (for example, processing for different programmes)
+  /// can run at the same time. if a step throws, no more steps are started,
+  /// and the exception is re-thrown once the running steps have finished
+  void run_parallel(size_t n_threads);
+
+  /// record the time taken by each step in profiler
+  void set_profiler(const std::shared_ptr<Profiler> &profiler);
+
+  /// get the profile for step i, or nullptr if this plan is not being
+  /// profiled
+  CallProfile *step_profile(size_t i) const { return step_profiles_.size() ? &step_profiles_.at(i)->run : nullptr; }
+
  private:
   Graph graph_;
   std::vector<ExecStepPtr> steps_;
+  std::vector<std::vector<size_t>> dependencies_;
+  std::shared_ptr<Profiler> profiler_;
+  std::vector<StepProfile *> step_profiles_;
+};
+
+/// options which control how a graph is planned and ran
+struct PlanOptions {
+  /// run each process within a streaming subgraph on its own thread, rather
+  /// than calling them in turn from the thread which runs the plan
+  ///
+  /// this produces the same results, but processes can overlap in time
+  bool threaded_streaming = false;
+
+  /// if set, record the time taken by each step and atomic process, and the
+  /// items passing through each stream port
+  std::shared_ptr<Profiler> profiler;
+
+  /// number of bytes which may be used by all buffers in the plan to hold
+  /// items in memory rather than on disk (see MakeBuffer)
+  ///
+  /// this only applies to buffers which would otherwise use the disk; the
+  /// default buffers always hold items in memory
+  size_t buffer_memory = 256 * 1024 * 1024;
 };
 
 /// plan the evaluation of graph
-Plan plan(const Graph &g);
+Plan plan(const Graph &g, const PlanOptions &options = {});
 
-/// evaluate a graph; equivalent to plan(g).run()
-void evaluate(const Graph &g);
+/// evaluate a graph; equivalent to plan(g, options).run()
+void evaluate(const Graph &g, const PlanOptions &options = {});
 
 /// run a plan while printing progress updates to the terminal
 void run_with_progress(const Plan &p);
@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+namespace eat::framework {
+
+/// a number of bytes of memory which may be shared between users, for example
+/// buffers which can hold some data in memory rather than on disk
+///
+/// this is thread-safe, as users may run in parallel
+class MemoryBudget {
+ public:
+  explicit MemoryBudget(size_t bytes) : available_(bytes) {}
+
+  /// reserve bytes if they are available, returning true if they were
+  /// reserved; reserved bytes must be given back with release()
+  bool try_reserve(size_t bytes) {
+    size_t available = available_.load();
+    do {
+      if (bytes > available) return false;
+    } while (!available_.compare_exchange_weak(available, available - bytes));
+    return true;
+  }
+
+  /// give back bytes reserved by try_reserve()
+  void release(size_t bytes) { available_ += bytes; }
+
+  /// number of bytes which are not reserved
+  size_t available() const { return available_.load(); }
+
+ private:
+  std::atomic<size_t> available_;
+};
+
+using MemoryBudgetPtr = std::shared_ptr<MemoryBudget>;
+
+}  // namespace eat::framework
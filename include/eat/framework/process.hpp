@@ -1,12 +1,17 @@
 #pragma once
-#include <deque>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <optional>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "memory_budget.hpp"
+#include "ring_buffer.hpp"
+#include "value_ptr.hpp"
+
 namespace eat::framework {
 
 class Port;
@@ -48,9 +53,19 @@ class Graph {
 
  private:
   std::vector<ProcessPtr> processes;
+  /// ports of registered processes, and whether they are input ports, so
+  /// that connect() does not have to search all processes. ports added to a
+  /// process after it was registered are not in here
+  std::unordered_map<const Port *, bool> port_is_input;
 
  protected:
   std::map<PortPtr, PortPtr> port_inputs;
+
+  /// check that a is an output and b is an input of processes in this graph
+  ///
+  /// found_a and found_b are set if a or b were found, and an exception is
+  /// thrown if they were found but are the wrong direction
+  void find_sub_process_ports(const PortPtr &a, const PortPtr &b, bool &found_a, bool &found_b) const;
 };
 
 /// abstract process, for referencing either an atomic or composite process
@@ -109,6 +124,19 @@ class FunctionalAtomicProcess : public AtomicProcess {
   virtual void process() = 0;
 };
 
+/// describes where the items written to a streaming output port come from,
+/// for processes which output an unmodified copy of some external data (for
+/// example, the samples in a file)
+///
+/// subclasses are defined by the processes which produce and accept them; see
+/// StreamingAtomicProcess::passthrough_source and
+/// StreamingAtomicProcess::passthrough
+class PassthroughSource {
+ public:
+  virtual ~PassthroughSource() {}
+};
+using PassthroughSourcePtr = std::shared_ptr<const PassthroughSource>;
+
 /// streaming process with the following callbacks:
 ///
 /// - initialise() will be called once, after all processes connected to this
@@ -129,6 +157,42 @@ class StreamingAtomicProcess : public AtomicProcess {
 
   /// get progress for this process as a fraction between 0 and 1 if known
   virtual std::optional<float> get_progress() { return std::nullopt; }
+
+  /// can duplicate() make a copy of this process? this must be overridden
+  /// along with duplicate(), and lets the planner check without making a copy
+  virtual bool is_duplicable() const { return false; }
+
+  /// make a new process called name with the same ports as this one, which
+  /// produces the same outputs given the same inputs and has no side-effects,
+  /// or return nullptr (the default) if this is not possible
+  ///
+  /// this is called before running, and is used to break streaming
+  /// connections between sub-graphs by running copies of the upstream
+  /// processes (e.g. reading a file again), rather than buffering the items;
+  /// it is only called if is_duplicable() returns true
+  virtual StreamingAtomicProcessPtr duplicate(const std::string & /* name */) const { return nullptr; }
+
+  /// if the items written to the output port called port_name are an
+  /// unmodified copy of some external data, return a description of it, or
+  /// return nullptr (the default) otherwise
+  ///
+  /// if this process has no inputs, and its only output is connected to a
+  /// process which can read the same data directly (see passthrough()), this
+  /// process is removed before running
+  virtual PassthroughSourcePtr passthrough_source(const std::string & /* port_name */) const { return nullptr; }
+
+  /// make a new process called name with the same ports as this one, except
+  /// for the streaming input port called port_name, which does the same thing
+  /// as this process but reads the data from source rather than through the
+  /// port, or return nullptr (the default) if this is not possible
+  ///
+  /// this is called before running for processes with one streaming input,
+  /// and can be used to avoid decoding and re-encoding data which is not
+  /// modified (e.g. copying the samples between files)
+  virtual ProcessPtr passthrough(const std::string & /* name */, const std::string & /* port_name */,
+                                 const PassthroughSource & /* source */) const {
+    return nullptr;
+  }
 };
 
 /// A process which just contains some other processes, and connections between
@@ -149,11 +213,24 @@ class Port {
   virtual ~Port() = default;
   const std::string &name() const { return name_; }
 
-  /// are connections between this and other valid (i.e. the same type)
+  /// are connections from this to other valid (i.e. the same type, or
+  /// streaming ports with types which can be converted; see ConvertStream)
   virtual bool compatible(const PortPtr &other) const = 0;
 
+  /// mark an input port as read-only, meaning that the process will not
+  /// modify the values it receives in-place (for example through
+  /// ValuePtr::move_or_copy)
+  ///
+  /// when an output is connected to several inputs, values are shared between
+  /// them, so modifying a value requires a copy unless the other inputs have
+  /// finished with it. executors use this to run read-only processes first, so
+  /// that a single modifying process can take ownership without copying
+  void set_read_only(bool read_only = true) { read_only_ = read_only; }
+  bool read_only() const { return read_only_; }
+
  private:
   std::string name_;
+  bool read_only_ = false;
 };
 
 /// abstract port for non-streaming data; see DataPort<T>
@@ -210,8 +287,18 @@ using DataPortPtr = std::shared_ptr<DataPort<T>>;
 ///
 /// the input side calls pop() while available(), and can know that no more data
 /// will become available if eof()
+///
+/// each port has a capacity; when an input port holds at least this many
+/// items it is full(), and executors will avoid running processes which write
+/// to it until some items have been read, so that fast processes do not run
+/// arbitrarily far ahead of slow ones. this is not a hard limit: a process may
+/// push more than capacity items in one call, and executors will ignore it
+/// rather than deadlock if no process could otherwise run
 class StreamPortBase : public Port {
  public:
+  /// capacity of newly created ports
+  static constexpr size_t default_capacity = 32;
+
   /// end the stream of data
   virtual void close() = 0;
 
@@ -222,6 +309,28 @@ class StreamPortBase : public Port {
   /// drained)
   virtual bool eof_triggered() = 0;
 
+  /// number of items waiting to be read
+  virtual size_t size() const = 0;
+
+  /// number of items this port should hold before it is full()
+  virtual size_t capacity() const = 0;
+
+  /// number of items popped from this port while they were shared with other
+  /// ports (see is_shared_value), and therefore would be copied if modified
+  ///
+  /// this is not counted for read-only ports, so is the number of copies
+  /// caused by connecting one output to multiple inputs; it's mainly useful
+  /// for checking that graphs don't copy unnecessarily
+  virtual size_t shared_pop_count() const = 0;
+
+  /// total number of samples in the items waiting to be read (see
+  /// item_sample_count); this looks at every item, so is only used when
+  /// profiling
+  virtual size_t sample_count() const = 0;
+
+  /// are there at least capacity() items waiting to be read
+  bool full() const { return size() >= capacity(); }
+
   // internals used to connect ports:
 
   virtual void copy_to(StreamPortBase &other) = 0;
@@ -231,21 +340,43 @@ class StreamPortBase : public Port {
   /// get a process with a compatible streaming input and a non-streaming
   /// output compatible with get_buffer_writer(), which writes the inputs to a
   /// buffer
-  virtual ProcessPtr get_buffer_writer(const std::string &name) = 0;
+  ///
+  /// buffers which would otherwise be written to disk may hold items in
+  /// memory while they fit in memory_budget, which is shared by all buffers
+  /// in a plan; this may be null, in which case no memory is reserved
+  virtual ProcessPtr get_buffer_writer(const std::string &name, const MemoryBudgetPtr &memory_budget) = 0;
   /// get a process with a compatible streaming output and a non-streaming
   /// input compatible with get_buffer_reader(), which reads from a buffer
   virtual ProcessPtr get_buffer_reader(const std::string &name) = 0;
 
+  /// get a process with a streaming input called "in" compatible with this
+  /// port and a streaming output called "out" with the same type as to, which
+  /// converts between the two types, or return nullptr if this port has the
+  /// same type as to, or the types can not be converted
+  virtual ProcessPtr get_converter(const std::string &name, const StreamPortBase &to) const = 0;
+
+  /// make a new port with the same type as this one, used by executors to hold
+  /// items which are in transit between processes
+  virtual StreamPortBasePtr make_similar(const std::string &name) const = 0;
+
   using Port::Port;
 };
 
 /// stream port containing items of type T
+///
+/// items are stored in a RingBuffer, so that the storage is reused. push() and
+/// pop() may be called on different threads at the same time as long as push()
+/// is not called while the port is full (see try_push); all other operations
+/// must not be used concurrently
 template <typename T>
 class StreamPort : public StreamPortBase {
  public:
   virtual bool compatible(const PortPtr &other) const override;
 
   void push(T value);
+  /// push value if the port is not full, returning false (and leaving value
+  /// unchanged) otherwise; this never allocates
+  bool try_push(T &&value);
   bool available() const;
   T pop();
 
@@ -256,18 +387,28 @@ class StreamPort : public StreamPortBase {
   // internals
 
   virtual bool eof_triggered() override;
+  virtual size_t size() const override;
+  virtual size_t capacity() const override;
+  virtual size_t shared_pop_count() const override;
+  virtual size_t sample_count() const override;
+  /// change the capacity, reserving storage for this many items
+  void set_capacity(size_t capacity);
   virtual void copy_to(StreamPortBase &other) override;
   virtual void move_to(StreamPortBase &other) override;
   virtual void clear() override;
 
-  virtual ProcessPtr get_buffer_writer(const std::string &name) override;
+  virtual ProcessPtr get_buffer_writer(const std::string &name, const MemoryBudgetPtr &memory_budget) override;
   virtual ProcessPtr get_buffer_reader(const std::string &name) override;
+  virtual ProcessPtr get_converter(const std::string &name, const StreamPortBase &to) const override;
+  virtual StreamPortBasePtr make_similar(const std::string &name) const override;
 
   using StreamPortBase::StreamPortBase;
 
  private:
-  std::deque<T> queue;
-  bool eof_ = false;
+  RingBuffer<T> queue{default_capacity};
+  size_t capacity_ = default_capacity;
+  size_t shared_pop_count_ = 0;
+  std::atomic<bool> eof_ = false;
 };
 
 template <typename T>
@@ -276,10 +417,25 @@ using StreamPortPtr = std::shared_ptr<StreamPort<T>>;
 /// for specialising get_buffer_writer / get_buffer_reader for different types
 template <typename T>
 struct MakeBuffer {
-  static ProcessPtr get_buffer_writer(const std::string &name);
+  static ProcessPtr get_buffer_writer(const std::string &name, const MemoryBudgetPtr &memory_budget = nullptr);
   static ProcessPtr get_buffer_reader(const std::string &name);
 };
 
+/// for specialising get_converter for different types, so that streaming
+/// ports carrying different representations of the same data (e.g. planar
+/// and interleaved samples) can be connected
+///
+/// when ports with different types are connected, the planner inserts the
+/// process returned by get_converter between them; by default no conversions
+/// are possible
+template <typename T>
+struct ConvertStream {
+  /// can items of type T be converted to the type of to
+  static bool can_convert(const StreamPortBase & /* to */) { return false; }
+  /// see StreamPortBase::get_converter
+  static ProcessPtr get_converter(const std::string & /* name */, const StreamPortBase & /* to */) { return nullptr; }
+};
+
 // implementations
 
 template <typename T, typename... Args>
@@ -356,31 +512,41 @@ void DataPort<T>::copy_to(DataPortBase &other) {
 
 template <typename T>
 bool StreamPort<T>::compatible(const PortPtr &other) const {
-  return static_cast<bool>(std::dynamic_pointer_cast<StreamPort<T>>(other));
+  if (std::dynamic_pointer_cast<StreamPort<T>>(other)) return true;
+  auto other_stream = std::dynamic_pointer_cast<StreamPortBase>(other);
+  return other_stream && ConvertStream<T>::can_convert(*other_stream);
 }
 
 template <typename T>
 bool StreamPort<T>::available() const {
-  return queue.size();
+  return !queue.empty();
 }
 
 template <typename T>
 void StreamPort<T>::push(T value) {
   if (eof_) throw std::runtime_error("push to closed queue");
-  queue.push_back(std::move(value));
+  queue.push(std::move(value));
+}
+
+template <typename T>
+bool StreamPort<T>::try_push(T &&value) {
+  if (eof_) throw std::runtime_error("push to closed queue");
+  if (full()) return false;
+  return queue.try_push(std::move(value));
 }
 
 template <typename T>
 T StreamPort<T>::pop() {
-  if (!queue.size()) throw std::runtime_error("pop from empty queue");
-  T value = std::move(queue.front());  // ?
-  queue.pop_front();
+  if (queue.empty()) throw std::runtime_error("pop from empty queue");
+  T value = queue.pop();
+  if (!read_only() && is_shared_value(value)) shared_pop_count_++;
   return value;
 }
 
 template <typename T>
 bool StreamPort<T>::eof() {
-  return !queue.size() && eof_;
+  // check eof_ first: if it's set, all pushed items are visible
+  return eof_ && queue.empty();
 }
 
 template <typename T>
@@ -393,11 +559,41 @@ bool StreamPort<T>::eof_triggered() {
   return eof_;
 }
 
+template <typename T>
+size_t StreamPort<T>::size() const {
+  return queue.size();
+}
+
+template <typename T>
+size_t StreamPort<T>::capacity() const {
+  return capacity_;
+}
+
+template <typename T>
+size_t StreamPort<T>::shared_pop_count() const {
+  return shared_pop_count_;
+}
+
+template <typename T>
+size_t StreamPort<T>::sample_count() const {
+  size_t total = 0;
+  for (size_t i = 0; i < queue.size(); i++) total += item_sample_count(queue[i]);
+  return total;
+}
+
+template <typename T>
+void StreamPort<T>::set_capacity(size_t capacity) {
+  if (!capacity) throw std::runtime_error("stream port capacity must be at least 1");
+  capacity_ = capacity;
+  queue.grow(capacity);
+}
+
 template <typename T>
 void StreamPort<T>::copy_to(StreamPortBase &other) {
   auto &other_t = dynamic_cast<StreamPort<T> &>(other);
-  for (auto &item : queue) {
-    other_t.push(item);
+  size_t n = queue.size();
+  for (size_t i = 0; i < n; i++) {
+    other_t.push(queue[i]);
   }
   if (eof_) other_t.close();
 }
@@ -405,8 +601,8 @@ void StreamPort<T>::copy_to(StreamPortBase &other) {
 template <typename T>
 void StreamPort<T>::move_to(StreamPortBase &other) {
   auto &other_t = dynamic_cast<StreamPort<T> &>(other);
-  for (auto &&item : queue) {
-    other_t.push(std::move(item));
+  while (!queue.empty()) {
+    other_t.push(queue.pop());
   }
   if (eof_) other_t.close();
 }
@@ -481,8 +677,8 @@ class InMemBufferRead : public StreamingAtomicProcess {
 }  // namespace detail
 
 template <typename T>
-ProcessPtr StreamPort<T>::get_buffer_writer(const std::string &name) {
-  return MakeBuffer<T>::get_buffer_writer(name);
+ProcessPtr StreamPort<T>::get_buffer_writer(const std::string &name, const MemoryBudgetPtr &memory_budget) {
+  return MakeBuffer<T>::get_buffer_writer(name, memory_budget);
 }
 
 template <typename T>
@@ -490,13 +686,27 @@ ProcessPtr StreamPort<T>::get_buffer_reader(const std::string &name) {
   return MakeBuffer<T>::get_buffer_reader(name);
 }
 
+template <typename T>
+ProcessPtr StreamPort<T>::get_converter(const std::string &name, const StreamPortBase &to) const {
+  if (dynamic_cast<const StreamPort<T> *>(&to)) return nullptr;
+  return ConvertStream<T>::get_converter(name, to);
+}
+
+template <typename T>
+StreamPortBasePtr StreamPort<T>::make_similar(const std::string &name) const {
+  auto port = std::make_shared<StreamPort<T>>(name);
+  port->set_capacity(capacity_);
+  port->set_read_only(read_only());
+  return port;
+}
+
 template <typename T>
 ProcessPtr MakeBuffer<T>::get_buffer_reader(const std::string &name) {
   return std::make_shared<detail::InMemBufferRead<T>>(name);
 }
 
 template <typename T>
-ProcessPtr MakeBuffer<T>::get_buffer_writer(const std::string &name) {
+ProcessPtr MakeBuffer<T>::get_buffer_writer(const std::string &name, const MemoryBudgetPtr &) {
   return std::make_shared<detail::InMemBufferWrite<T>>(name);
 }
 
@@ -0,0 +1,94 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <string>
+
+namespace eat::framework {
+
+/// time spent in, and number of calls to, one kind of call
+struct CallProfile {
+  size_t calls = 0;
+  /// total wall-clock time in seconds
+  double wall_time = 0.0;
+  /// total CPU time in seconds, measured for the calling thread
+  double cpu_time = 0.0;
+};
+
+/// items passing through a stream port
+///
+/// for input ports this counts items read by the process, and max_queued is
+/// the largest number of items waiting when process() was called; for output
+/// ports this counts items written by the process, and max_queued is the
+/// largest number of items waiting when process() returned
+struct PortProfile {
+  size_t items = 0;
+  /// samples in the items (see item_sample_count)
+  size_t samples = 0;
+  size_t max_queued = 0;
+};
+
+/// calls to one atomic process; functional processes only use process
+struct ProcessProfile {
+  std::string name;
+  CallProfile initialise;
+  CallProfile process;
+  CallProfile finalise;
+  /// stream ports, by name
+  std::map<std::string, PortProfile> in_ports;
+  std::map<std::string, PortProfile> out_ports;
+};
+
+/// calls to run() on one step of a plan
+struct StepProfile {
+  std::string description;
+  CallProfile run;
+};
+
+/// collects profiling information while running plans
+///
+/// pass one of these in PlanOptions to profile each step and atomic process in
+/// the plan. entries are added while planning and not removed, so references
+/// to them remain valid. each entry is only written by one thread at a time,
+/// so this should not be read while a plan is running
+class Profiler {
+ public:
+  /// add an entry for a process named name, returning a reference which will
+  /// remain valid for the lifetime of this Profiler
+  ProcessProfile &add_process(std::string name);
+
+  /// add an entry for a plan step, returning a reference which will remain
+  /// valid for the lifetime of this Profiler
+  StepProfile &add_step(std::string description);
+
+  const std::deque<ProcessProfile> &processes() const { return processes_; }
+  const std::deque<StepProfile> &steps() const { return steps_; }
+
+ private:
+  std::deque<ProcessProfile> processes_;
+  std::deque<StepProfile> steps_;
+};
+
+/// CPU time used by the calling thread, in seconds
+double thread_cpu_time();
+
+/// call f, adding the time taken to profile if it is not null
+template <typename F>
+void profile_call(CallProfile *profile, F &&f) {
+  if (!profile) {
+    f();
+    return;
+  }
+
+  auto wall_start = std::chrono::steady_clock::now();
+  double cpu_start = thread_cpu_time();
+
+  f();
+
+  profile->cpu_time += thread_cpu_time() - cpu_start;
+  profile->wall_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+  profile->calls++;
+}
+
+}  // namespace eat::framework
@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace eat::framework {
+
+/// queue of items stored in a circular buffer, used to implement StreamPort
+///
+/// storage is allocated up-front and reused, so pushing and popping does not
+/// allocate. one thread may push while another pops without any locking
+/// (single producer, single consumer), as long as the storage does not need
+/// to grow; grow() and clear() must not be called while another thread is
+/// using the buffer
+template <typename T>
+class RingBuffer {
+ public:
+  /// make a buffer with storage for at least n_items items
+  explicit RingBuffer(size_t n_items = 1) : slots(round_up(n_items)) {}
+
+  RingBuffer(const RingBuffer &) = delete;
+  RingBuffer &operator=(const RingBuffer &) = delete;
+
+  /// number of items that can be stored without growing
+  size_t storage_size() const { return slots.size(); }
+
+  /// number of items in the queue; if another thread is pushing or popping
+  /// this may be out of date, but is never more than the real value plus the
+  /// number of items being popped
+  size_t size() const {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return tail - head;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  /// push value if there is space in the storage; value is only moved from
+  /// if this returns true
+  ///
+  /// only call this from the producer thread
+  bool try_push(T &&value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == slots.size()) return false;
+
+    slots[tail & (slots.size() - 1)].emplace(std::move(value));
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// push value, growing the storage if necessary
+  ///
+  /// only call this from the producer thread, and only when no other thread
+  /// is popping, as growing moves the stored items
+  void push(T value) {
+    if (!try_push(std::move(value))) {
+      grow(2 * slots.size());
+      try_push(std::move(value));
+    }
+  }
+
+  /// remove and return the first item; the queue must not be empty
+  ///
+  /// only call this from the consumer thread
+  T pop() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (tail_.load(std::memory_order_acquire) == head) throw std::runtime_error("pop from empty ring buffer");
+
+    auto &slot = slots[head & (slots.size() - 1)];
+    T value = std::move(*slot);
+    slot.reset();
+    head_.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+  /// access the i'th item from the front of the queue
+  ///
+  /// only call this from the consumer thread
+  T &operator[](size_t i) { return *slots[(head_.load(std::memory_order_relaxed) + i) & (slots.size() - 1)]; }
+  const T &operator[](size_t i) const {
+    return *slots[(head_.load(std::memory_order_relaxed) + i) & (slots.size() - 1)];
+  }
+
+  /// increase the storage size to hold at least n_items items
+  void grow(size_t n_items) {
+    size_t new_size = round_up(n_items);
+    if (new_size <= slots.size()) return;
+
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t n = size();
+
+    std::vector<std::optional<T>> new_slots(new_size);
+    for (size_t i = 0; i < n; i++) new_slots[i] = std::move(slots[(head + i) & (slots.size() - 1)]);
+
+    slots = std::move(new_slots);
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(n, std::memory_order_release);
+  }
+
+  /// remove all items, keeping the storage
+  void clear() {
+    for (auto &slot : slots) slot.reset();
+    head_.store(tail_.load(std::memory_order_relaxed), std::memory_order_release);
+  }
+
+ private:
+  /// round up to a power of two, so that indices can be wrapped with a mask
+  static size_t round_up(size_t n) {
+    size_t size = 1;
+    while (size < n) size *= 2;
+    return size;
+  }
+
+  std::vector<std::optional<T>> slots;
+  /// index of the next item to pop; only written by the consumer
+  std::atomic<size_t> head_ = 0;
+  /// index of the next item to push; only written by the producer
+  std::atomic<size_t> tail_ = 0;
+};
+
+}  // namespace eat::framework
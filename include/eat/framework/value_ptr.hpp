@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <memory>
 
 namespace eat::framework {
@@ -10,6 +11,14 @@ std::shared_ptr<T> copy_shared_ptr(const std::shared_ptr<T> &value) {
   return std::make_shared<T>(*value);
 }
 
+/// can value be modified in place by its only user? this can be overloaded
+/// for types which may refer to storage that must not be modified (e.g. a view
+/// of a read-only file mapping), so that ValuePtr copies them instead
+template <typename T>
+bool is_modifiable_value(const T &) {
+  return true;
+}
+
 /// a wrapper around shared_ptr that has more value-like semantics while
 /// avoiding copies where possible
 ///
@@ -28,12 +37,16 @@ class ValuePtr {
   /// get read-only access to the value
   std::shared_ptr<const T> read() const { return value; }
 
+  /// is the value shared with other ValuePtrs, in which case move_or_copy()
+  /// will make a copy
+  bool is_shared() const { return value.use_count() > 1; }
+
   /// get a non-const value that can be modified
   ///
-  /// this makes a copy if there are multiple users of the underlying value, or
-  /// moves if there is only one
+  /// this makes a copy if there are multiple users of the underlying value or
+  /// it can not be modified (see is_modifiable_value), or moves otherwise
   std::shared_ptr<T> move_or_copy() const {
-    if (value.use_count() > 1)
+    if (value.use_count() > 1 || (value && !is_modifiable_value(*value)))
       return copy_shared_ptr(value);
     else
       return std::move(value);
@@ -43,4 +56,31 @@ class ValuePtr {
   std::shared_ptr<T> value;
 };
 
+/// is value shared with other copies, such that modifying it would require a
+/// copy? this is used by StreamPort to count copies caused by connecting an
+/// output to multiple inputs, and can be overloaded for other types
+template <typename T>
+bool is_shared_value(const T &) {
+  return false;
+}
+
+template <typename T>
+bool is_shared_value(const ValuePtr<T> &value) {
+  return value.is_shared();
+}
+
+/// number of audio samples (per channel) held by value; this is used when
+/// profiling to count the samples passing through each StreamPort, and should
+/// be overloaded for types which hold samples
+template <typename T>
+size_t item_sample_count(const T &) {
+  return 0;
+}
+
+template <typename T>
+size_t item_sample_count(const ValuePtr<T> &value) {
+  auto ptr = value.read();
+  return ptr ? item_sample_count(*ptr) : 0;
+}
+
 }  // namespace eat::framework
@@ -1,6 +1,10 @@
 #pragma once
 
 #include <adm/elements_fwd.hpp>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "chna.hpp"
 #include "eat/framework/process.hpp"
@@ -15,6 +19,27 @@ namespace eat::process {
 struct ADMData {
   framework::ValuePtr<adm::Document> document;
   channel_map_t channel_map;
+  /// time in the ADM timeline of the first sample in the associated stream,
+  /// which is not zero if only part of a file was read
+  std::chrono::nanoseconds start{0};
+};
+
+/// format of samples written to BW64 files
+enum class SampleFormat {
+  Int16,
+  Int24,
+  Int32,
+  /// 32-bit IEEE float, which is written without conversion or clipping
+  Float32,
+};
+
+/// part of a file to read
+struct TimeRange {
+  /// time of the first sample to read in seconds
+  double start = 0.0;
+  /// length of the part to read in seconds, or std::nullopt to read to the
+  /// end of the file
+  std::optional<double> duration;
 };
 
 /// read samples from a BW64 file
@@ -24,7 +49,15 @@ struct ADMData {
 ///
 /// @param path path to the file to read
 /// @param block_size maximum number of samples in each output block
-framework::ProcessPtr make_read_bw64(const std::string &name, const std::string &path, size_t block_size);
+/// @param read_ahead if not 0, read on a background thread, with up to this
+///     many blocks read before they are needed
+/// @param channels if not empty, only output these (zero-based) channels, in
+///     this order; other channels are not decoded
+/// @param range part of the file to read; the reader seeks straight to the
+///     start
+framework::ProcessPtr make_read_bw64(const std::string &name, const std::string &path, size_t block_size,
+                                     size_t read_ahead = 0, const std::vector<size_t> &channels = {},
+                                     const TimeRange &range = {});
 
 /// write samples to a BW64 file
 ///
@@ -32,7 +65,11 @@ framework::ProcessPtr make_read_bw64(const std::string &name, const std::string
 /// - in_samples (StreamPort<InterleavedBlockPtr>) : input samples
 ///
 /// @param path path to the file to read
-framework::ProcessPtr make_write_bw64(const std::string &name, const std::string &path);
+/// @param write_behind if not 0, write on a background thread, with up to
+///     this many blocks waiting to be written
+/// @param format format of samples in the file
+framework::ProcessPtr make_write_bw64(const std::string &name, const std::string &path, size_t write_behind = 0,
+                                      SampleFormat format = SampleFormat::Int24);
 
 /// read ADM data from a BW64 ADM file
 ///
@@ -50,7 +87,16 @@ framework::ProcessPtr make_read_adm(const std::string &name, const std::string &
 ///
 /// @param path path to the file to read
 /// @param block_size maximum number of samples in each output block
-framework::ProcessPtr make_read_adm_bw64(const std::string &name, const std::string &path, size_t block_size);
+/// @param read_ahead if not 0, read samples on a background thread, with up
+///     to this many blocks read before they are needed
+/// @param channels if not empty, only output these (zero-based) channels, in
+///     this order; other channels are not decoded, and their audioTrackUids
+///     are removed from the ADM data
+/// @param range part of the file to read; the reader seeks straight to the
+///     start, and ADMData::start is set to the time of the first sample
+framework::ProcessPtr make_read_adm_bw64(const std::string &name, const std::string &path, size_t block_size,
+                                         size_t read_ahead = 0, const std::vector<size_t> &channels = {},
+                                         const TimeRange &range = {});
 
 /// write samples and ADM data to a BW64 file
 ///
@@ -58,7 +104,11 @@ framework::ProcessPtr make_read_adm_bw64(const std::string &name, const std::str
 /// - in_samples (StreamPort<InterleavedBlockPtr>) : input samples
 ///
 /// @param path path to the file to read
-framework::ProcessPtr make_write_adm_bw64(const std::string &name, const std::string &path);
+/// @param write_behind if not 0, write samples on a background thread, with
+///     up to this many blocks waiting to be written
+/// @param format format of samples in the file
+framework::ProcessPtr make_write_adm_bw64(const std::string &name, const std::string &path,
+                                          size_t write_behind = 0, SampleFormat format = SampleFormat::Int24);
 
 }  // namespace eat::process
 
@@ -4,6 +4,7 @@
 #pragma once
 #include <cassert>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -31,14 +32,43 @@ class InterleavedSampleBlock {
  public:
   /// construct with existing samples, which must have a size of sample_count * channel_count
   InterleavedSampleBlock(std::vector<float> samples, BlockDescription blockInfo)
-      : samples_(std::move(samples)), info_{blockInfo} {
+      : samples_(std::move(samples)), data_(samples_.data()), info_{blockInfo} {
     framework::always_assert(samples_.size() == info_.sample_count * info_.channel_count,
                              "wrong number of samples in SampleBlock");
   }
 
   /// construct with zero-valued  samples
   InterleavedSampleBlock(BlockDescription blockInfo)
-      : samples_(blockInfo.sample_count * blockInfo.channel_count), info_{blockInfo} {}
+      : samples_(blockInfo.sample_count * blockInfo.channel_count), data_(samples_.data()), info_{blockInfo} {}
+
+  /// construct a read-only view of sample_count * channel_count samples
+  /// stored elsewhere (e.g. a file mapping), which are kept alive by owner
+  ///
+  /// the samples are never modified through this block: ValuePtr copies views
+  /// rather than handing them out for modification (see is_modifiable_value),
+  /// and non-const access to the samples copies them into storage owned by
+  /// the block first. copies of this block have their own storage
+  InterleavedSampleBlock(std::shared_ptr<const void> owner, const float *data, BlockDescription blockInfo)
+      : owner_(std::move(owner)), data_(data), info_{blockInfo} {}
+
+  InterleavedSampleBlock(const InterleavedSampleBlock &other)
+      : samples_(other.data_, other.data_ + other.info_.sample_count * other.info_.channel_count),
+        data_(samples_.data()),
+        info_(other.info_) {}
+
+  InterleavedSampleBlock(InterleavedSampleBlock &&other) noexcept
+      : samples_(std::move(other.samples_)),
+        owner_(std::move(other.owner_)),
+        data_(other.data_),
+        info_(other.info_) {}
+
+  InterleavedSampleBlock &operator=(InterleavedSampleBlock other) noexcept {
+    samples_ = std::move(other.samples_);
+    owner_ = std::move(other.owner_);
+    data_ = other.data_;
+    info_ = other.info_;
+    return *this;
+  }
 
   /// get the block description (sample and channel count, sample rate)
   [[nodiscard]] BlockDescription const &info() const { return info_; }
@@ -48,30 +78,49 @@ class InterleavedSampleBlock {
     assert(channel < info_.channel_count);
     assert(sample < info_.sample_count);
 
-    return samples_[info_.channel_count * sample + channel];
+    return data_[info_.channel_count * sample + channel];
   };
   /// access a single sample
   float &sample(size_t channel, size_t sample) {
     assert(channel < info_.channel_count);
     assert(sample < info_.sample_count);
 
-    return samples_[info_.channel_count * sample + channel];
+    return data()[info_.channel_count * sample + channel];
   }
 
   /// access the sample data
   ///
   /// sample s of channel c is at data()[s * info().channel_count + c]
-  [[nodiscard]] const float *data() const { return samples_.data(); }
+  [[nodiscard]] const float *data() const { return data_; }
   /// access the sample data
   ///
   /// sample s of channel c is at data()[s * info().channel_count + c]
-  float *data() { return samples_.data(); }
+  ///
+  /// if this is a view, the samples are copied first
+  float *data() {
+    if (owner_) {
+      samples_.assign(data_, data_ + info_.sample_count * info_.channel_count);
+      data_ = samples_.data();
+      owner_.reset();
+    }
+    return samples_.data();
+  }
+
+  /// is this a read-only view of samples stored elsewhere?
+  [[nodiscard]] bool is_view() const { return owner_ != nullptr; }
 
  private:
+  /// storage, unless this is a view
   std::vector<float> samples_;
+  /// keeps the storage of a view alive
+  std::shared_ptr<const void> owner_;
+  const float *data_;
   BlockDescription info_;
 };
 
+/// views are copied by ValuePtr::move_or_copy() rather than being modified
+inline bool is_modifiable_value(const InterleavedSampleBlock &block) { return !block.is_view(); }
+
 /// pointer to an interleaved sample block
 using InterleavedBlockPtr = framework::ValuePtr<InterleavedSampleBlock>;
 
@@ -123,6 +172,17 @@ class PlanarSampleBlock {
 /// pointer to a planar sample block
 using PlanarBlockPtr = framework::ValuePtr<PlanarSampleBlock>;
 
+/// number of samples in a block, used when profiling
+inline size_t item_sample_count(const InterleavedSampleBlock &block) { return block.info().sample_count; }
+/// number of samples in a block, used when profiling
+inline size_t item_sample_count(const PlanarSampleBlock &block) { return block.info().sample_count; }
+
+/// convert an interleaved block to planar
+PlanarSampleBlock to_planar(const InterleavedSampleBlock &block);
+
+/// convert a planar block to interleaved
+InterleavedSampleBlock to_interleaved(const PlanarSampleBlock &block);
+
 /// a process which produces InterleavedSampleBlock objects from a buffer
 /// provided at initialisation
 class InterleavedStreamingAudioSource : public framework::StreamingAtomicProcess {
@@ -171,7 +231,9 @@ class InterleavedStreamingAudioSource : public framework::StreamingAtomicProcess
 class InterleavedStreamingAudioSink : public framework::StreamingAtomicProcess {
  public:
   explicit InterleavedStreamingAudioSink(std::string const &name)
-      : StreamingAtomicProcess(name), in(add_in_port<framework::StreamPort<InterleavedBlockPtr>>("in_samples")) {}
+      : StreamingAtomicProcess(name), in(add_in_port<framework::StreamPort<InterleavedBlockPtr>>("in_samples")) {
+    in->set_read_only();
+  }
 
   /// access the vector of samples
   std::vector<float> const &get() { return samples; }
@@ -215,13 +277,34 @@ class InterleavedStreamingAudioSink : public framework::StreamingAtomicProcess {
 };
 }  // namespace eat::process
 
-// overloads for buffering InterleavedSampleBlock objects to disk
+// overloads for buffering sample blocks to disk, and converting between
+// interleaved and planar blocks when ports with different types are connected
 namespace eat::framework {
 
 template <>
 ProcessPtr MakeBuffer<process::InterleavedBlockPtr>::get_buffer_reader(const std::string &name);
 
 template <>
-ProcessPtr MakeBuffer<process::InterleavedBlockPtr>::get_buffer_writer(const std::string &name);
+ProcessPtr MakeBuffer<process::InterleavedBlockPtr>::get_buffer_writer(const std::string &name,
+                                                                       const MemoryBudgetPtr &memory_budget);
+
+template <>
+ProcessPtr MakeBuffer<process::PlanarBlockPtr>::get_buffer_reader(const std::string &name);
+
+template <>
+ProcessPtr MakeBuffer<process::PlanarBlockPtr>::get_buffer_writer(const std::string &name,
+                                                                  const MemoryBudgetPtr &memory_budget);
+
+template <>
+struct ConvertStream<process::InterleavedBlockPtr> {
+  static bool can_convert(const StreamPortBase &to);
+  static ProcessPtr get_converter(const std::string &name, const StreamPortBase &to);
+};
+
+template <>
+struct ConvertStream<process::PlanarBlockPtr> {
+  static bool can_convert(const StreamPortBase &to);
+  static ProcessPtr get_converter(const std::string &name, const StreamPortBase &to);
+};
 
 }  // namespace eat::framework
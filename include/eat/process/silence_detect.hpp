@@ -39,7 +39,7 @@ class SilenceStatus {
       : config(silence_config),
         squared_threshold(detail::db_to_peak_amp(config.threshold) * detail::db_to_peak_amp(config.threshold)) {}
 
-  void process(InterleavedSampleBlock &block, std::size_t sample_number) {
+  void process(const InterleavedSampleBlock &block, std::size_t sample_number) {
     complete_interval = false;
     auto channelCount = block.info().channel_count;
     bool silent = channelCount > 0;
@@ -99,13 +99,15 @@ class SilenceDetector : public framework::StreamingAtomicProcess {
         in_samples(add_in_port<framework::StreamPort<InterleavedBlockPtr>>("in_samples")),
         out_intervals(add_out_port<framework::DataPort<std::vector<AudioInterval>>>("out_intervals")),
         status_config{config},
-        status{status_config} {}
+        status{status_config} {
+    in_samples->set_read_only();
+  }
 
   void initialise() override { status = SilenceStatus{status_config}; }
 
   void process() override {
     while (in_samples->available()) {
-      auto samples = in_samples->pop().move_or_copy();
+      auto samples = in_samples->pop().read();
       auto &info = samples->info();
       for (std::size_t sample = 0; sample != info.sample_count; ++sample) {
         status.process(*samples, sample);
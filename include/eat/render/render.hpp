@@ -8,9 +8,13 @@ namespace eat::render {
 /// render input audio and samples to channels
 /// ports:
 /// - in_axml (DataPort<ADMData>) : input ADM data
-/// - in_samples (StreamPort<InterleavedBlockPtr>) : input samples
+/// - in_samples (StreamPort<PlanarBlockPtr>) : input samples
+/// - out_samples (StreamPort<PlanarBlockPtr>) : output samples
 /// - out_axml (DataPort<ADMData>) : output ADM data
+///
+/// @param n_threads number of threads used to render objects; the output is
+///     the same on every run with the same number of threads
 framework::ProcessPtr make_render(const std::string &name, const ear::Layout &layout, size_t block_size,
-                                  const SelectionOptionsId &options = {});
+                                  const SelectionOptionsId &options = {}, size_t n_threads = 1);
 
 };  // namespace eat::render
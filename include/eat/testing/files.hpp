@@ -10,7 +10,7 @@ namespace eat::testing {
 /// are the contents of two files equal?
 inline bool files_equal(const std::string &fname_a, const std::string &fname_b) {
   std::fstream file_a(fname_a, std::ios_base::in | std::ios_base::binary);
-  std::fstream file_b(fname_a, std::ios_base::in | std::ios_base::binary);
+  std::fstream file_b(fname_b, std::ios_base::in | std::ios_base::binary);
 
   if (!file_a.is_open()) throw std::runtime_error("could not open " + fname_a);
   if (!file_b.is_open()) throw std::runtime_error("could not open " + fname_b);
@@ -1,6 +1,12 @@
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 #include "../eat/config_file/make_graph.hpp"
 #include "CLI/App.hpp"
@@ -19,7 +25,9 @@ nlohmann::json parse_jaon(T &&value, bool allow_exceptions = true) {
                                /*allow_exceptions*/ allow_exceptions, /*ignore_comments*/ true);
 }
 
-void set_value(nlohmann::json &config, const std::string &loc, nlohmann::json value) {
+/// split an option name (process_name.option_name) into the process name and
+/// a pointer into its parameters
+std::pair<std::string, nlohmann::json::json_pointer> parse_location(const std::string &loc) {
   size_t dot_pos = loc.find('.');
   if (dot_pos == std::string::npos) throw std::runtime_error("options must have the form process_name.option_name ");
 
@@ -28,7 +36,11 @@ void set_value(nlohmann::json &config, const std::string &loc, nlohmann::json va
   for (size_t i = 0; i < path_str.size(); i++)
     if (path_str[i] == '.') path_str[i] = '/';
 
-  nlohmann::json::json_pointer path{path_str};
+  return {process_name, nlohmann::json::json_pointer{path_str}};
+}
+
+void set_value(nlohmann::json &config, const std::string &loc, nlohmann::json value) {
+  auto [process_name, path] = parse_location(loc);
 
   auto &processes = config.at("processes");
   if (!processes.is_array()) throw std::runtime_error("expected processes to be object");
@@ -47,6 +59,151 @@ void set_value(nlohmann::json &config, const std::string &loc, nlohmann::json va
     }
   if (!found) throw std::runtime_error("could not find process named " + process_name);
 }
+
+/// does setting loc to value in config replace an existing value of the same
+/// type? if so, a valid config will usually still be valid afterwards
+bool replaces_same_type(const nlohmann::json &config, const std::string &loc, const nlohmann::json &value) {
+  auto [process_name, path] = parse_location(loc);
+
+  for (auto &process : config.at("processes"))
+    if (process.at("name").get<std::string>() == process_name) {
+      if (!process.contains("parameters") || !process.at("parameters").contains(path)) return false;
+      return process.at("parameters").at(path).type() == value.type();
+    }
+  return false;
+}
+
+/// one configuration to run in batch mode
+struct BatchJob {
+  /// options to set, as with --strict-option
+  nlohmann::json options;
+  /// the config with the options applied
+  nlohmann::json config;
+  /// error from applying the options or validating the config, in which case
+  /// the job is not run
+  std::string error;
+};
+
+/// read jobs from a batch file, which contains an array of objects mapping
+/// option names to JSON values
+///
+/// the options are applied to a copy of config for each job. if config_valid,
+/// jobs which only replace values with values of the same type (e.g. paths)
+/// are not validated again; errors in these are reported when the graph is
+/// built
+std::vector<BatchJob> load_batch(const nlohmann::json &batch_json, const nlohmann::json &config, bool config_valid) {
+  if (!batch_json.is_array()) throw std::runtime_error("expected batch file to contain an array of jobs");
+
+  std::vector<BatchJob> jobs;
+  for (auto &options : batch_json) {
+    BatchJob job{options, config, ""};
+    try {
+      if (!options.is_object()) throw std::runtime_error("expected job to be an object");
+
+      bool needs_validation = !config_valid;
+      for (auto &[path, value] : options.items()) {
+        if (!replaces_same_type(job.config, path, value)) needs_validation = true;
+        set_value(job.config, path, value);
+      }
+
+      if (needs_validation) {
+        std::stringstream ss;
+        try {
+          eat::process::validate_config(job.config, ss);
+        } catch (std::runtime_error const &e) {
+          throw std::runtime_error(std::string(e.what()) + ss.str());
+        }
+      }
+    } catch (std::exception const &e) {
+      job.error = e.what();
+    }
+    jobs.push_back(std::move(job));
+  }
+  return jobs;
+}
+
+nlohmann::json call_profile_json(const CallProfile &profile) {
+  return {{"calls", profile.calls}, {"wall_time", profile.wall_time}, {"cpu_time", profile.cpu_time}};
+}
+
+nlohmann::json ports_profile_json(const std::map<std::string, PortProfile> &ports) {
+  nlohmann::json ports_json = nlohmann::json::object();
+  for (auto &[name, port] : ports)
+    ports_json[name] = {{"items", port.items}, {"samples", port.samples}, {"max_queued", port.max_queued}};
+  return ports_json;
+}
+
+/// profile information for each process and step; times are in seconds
+///
+/// processes are listed rather than keyed by name, as processes inserted by
+/// the planner (buffers, conversions and duplicates) may share names
+nlohmann::json profile_json(const Profiler &profiler) {
+  nlohmann::json processes = nlohmann::json::array();
+  for (auto &process : profiler.processes())
+    processes.push_back({
+        {"name", process.name},
+        {"initialise", call_profile_json(process.initialise)},
+        {"process", call_profile_json(process.process)},
+        {"finalise", call_profile_json(process.finalise)},
+        {"in_ports", ports_profile_json(process.in_ports)},
+        {"out_ports", ports_profile_json(process.out_ports)},
+    });
+
+  nlohmann::json steps = nlohmann::json::array();
+  for (auto &step : profiler.steps()) {
+    nlohmann::json step_json = call_profile_json(step.run);
+    step_json["description"] = step.description;
+    steps.push_back(std::move(step_json));
+  }
+
+  return {{"processes", std::move(processes)}, {"steps", std::move(steps)}};
+}
+
+/// run jobs on n_workers threads, printing a line to stdout as each
+/// finishes; returns a report containing the status and wall-clock time (in
+/// seconds) for each job
+nlohmann::json run_batch(std::vector<BatchJob> &jobs, size_t n_workers, const PlanOptions &plan_options,
+                         size_t parallel) {
+  nlohmann::json report = nlohmann::json::array();
+  for (auto &job : jobs) report.push_back({{"options", job.options}});
+
+  std::atomic<size_t> next_job = 0;
+  std::mutex report_mutex;
+
+  auto worker = [&]() {
+    for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+      auto start = std::chrono::steady_clock::now();
+      std::string error = jobs[i].error;
+
+      if (error.empty()) {
+        try {
+          Graph g = make_graph(jobs[i].config);
+          Plan p = plan(g, plan_options);
+          p.run_parallel(parallel);
+        } catch (std::exception const &e) {
+          error = e.what();
+        }
+      }
+
+      double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      std::lock_guard<std::mutex> lock(report_mutex);
+      report[i]["status"] = error.empty() ? "ok" : "error";
+      if (!error.empty()) report[i]["error"] = error;
+      report[i]["wall_time"] = wall_time;
+
+      std::cout << "job " << i << ": " << (error.empty() ? "ok" : "error: " + error) << " (" << wall_time << " s)"
+                << std::endl;
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(n_workers, jobs.size()); i++) threads.emplace_back(worker);
+  worker();
+  for (auto &thread : threads) thread.join();
+
+  return report;
+}
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -63,7 +220,37 @@ int main(int argc, char **argv) {
                  "options to set or override in the config file, interpreted directly as json");
 
   bool progress;
-  app.add_flag("--progress,-p", progress, "show progress bars");
+  auto progress_opt = app.add_flag("--progress,-p", progress, "show progress bars");
+
+  bool threaded = false;
+  app.add_flag("--threaded,-t", threaded, "run streaming processes on separate threads");
+
+  size_t parallel = 1;
+  app.add_option("--parallel", parallel, "number of independent steps to run at the same time")
+      ->check(CLI::PositiveNumber);
+
+  std::string profile_file;
+  auto profile_opt = app.add_option("--profile", profile_file, "write time spent in each process to a json file");
+
+  size_t buffer_memory_mb = PlanOptions{}.buffer_memory / (1024 * 1024);
+  app.add_option("--buffer-memory", buffer_memory_mb,
+                 "MiB of memory used to hold samples between processing steps before using temporary files")
+      ->capture_default_str();
+
+  std::string batch_file;
+  app.add_option("--batch", batch_file,
+                 "json file containing an array of jobs, each an object of options to set (as with "
+                 "--strict-option); the config is run once for each job")
+      ->check(CLI::ExistingFile)
+      ->excludes(progress_opt)
+      ->excludes(profile_opt);
+
+  size_t jobs = 1;
+  app.add_option("--jobs,-j", jobs, "number of batch jobs to run at the same time")->check(CLI::PositiveNumber);
+
+  std::string batch_report_file;
+  app.add_option("--batch-report", batch_report_file,
+                 "write the status and time taken by each batch job to a json file");
 
   CLI11_PARSE(app, argc, argv);
 
@@ -82,24 +269,69 @@ int main(int argc, char **argv) {
     set_value(config_json, path, value_json);
   }
 
+  // in batch mode the config may be incomplete (e.g. missing paths) until
+  // the options for each job have been applied
+  bool config_valid = true;
   {
     std::stringstream ss;
     try {
       eat::process::validate_config(config_json, ss);
     } catch (std::runtime_error const &e) {
-      std::cerr << e.what();
-      std::cerr << ss.str();
-      return 65;  // user data error, EX_DATAERR
+      if (batch_file.empty()) {
+        std::cerr << e.what();
+        std::cerr << ss.str();
+        return 65;  // user data error, EX_DATAERR
+      }
+      config_valid = false;
+    }
+  }
+
+  PlanOptions plan_options;
+  plan_options.threaded_streaming = threaded;
+  plan_options.buffer_memory = buffer_memory_mb * 1024 * 1024;
+
+  if (!batch_file.empty()) {
+    nlohmann::json batch_json;
+    {
+      std::ifstream f(batch_file);
+      batch_json = parse_jaon(f);
+    }
+    auto batch_jobs = load_batch(batch_json, config_json, config_valid);
+
+    nlohmann::json report = run_batch(batch_jobs, jobs, plan_options, parallel);
+
+    if (!batch_report_file.empty()) {
+      std::ofstream f(batch_report_file);
+      f << report.dump(2) << "\n";
+      if (!f) {
+        std::cerr << "could not write batch report to " << batch_report_file << "\n";
+        return 74;  // EX_IOERR
+      }
     }
+
+    for (auto &job : report)
+      if (job.at("status") != "ok") return 1;
+    return 0;
   }
 
   Graph g = make_graph(config_json);
 
-  Plan p = plan(g);
+  if (!profile_file.empty()) plan_options.profiler = std::make_shared<Profiler>();
+
+  Plan p = plan(g, plan_options);
   if (progress)
     run_with_progress(p);
   else
-    p.run();
+    p.run_parallel(parallel);
+
+  if (plan_options.profiler) {
+    std::ofstream f(profile_file);
+    f << profile_json(*plan_options.profiler).dump(2) << "\n";
+    if (!f) {
+      std::cerr << "could not write profile to " << profile_file << "\n";
+      return 74;  // EX_IOERR
+    }
+  }
 
   return 0;
 }
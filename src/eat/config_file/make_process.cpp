@@ -113,30 +113,58 @@ framework::ProcessPtr make_read_adm(nlohmann::json &config, const std::string &n
   return process::make_read_adm(name, path);
 }
 
+process::TimeRange parse_time_range(nlohmann::json &config) {
+  process::TimeRange range;
+  range.start = get<double>(config, "start", 0.0);
+  range.duration = get_optional<double>(config, "duration");
+  return range;
+}
+
 framework::ProcessPtr make_read_bw64(nlohmann::json &config, const std::string &name) {
   std::string path = get<std::string>(config, "path");
   size_t block_size = get<size_t>(config, "block_size", 1024);
+  size_t read_ahead = get<size_t>(config, "read_ahead", 0);
+  auto channels = get<std::vector<size_t>>(config, "channels", {});
+  auto range = parse_time_range(config);
 
-  return process::make_read_bw64(name, path, block_size);
+  return process::make_read_bw64(name, path, block_size, read_ahead, channels, range);
 }
 
 framework::ProcessPtr make_read_adm_bw64(nlohmann::json &config, const std::string &name) {
   std::string path = get<std::string>(config, "path");
   size_t block_size = get<size_t>(config, "block_size", 1024);
+  size_t read_ahead = get<size_t>(config, "read_ahead", 0);
+  auto channels = get<std::vector<size_t>>(config, "channels", {});
+  auto range = parse_time_range(config);
+
+  return process::make_read_adm_bw64(name, path, block_size, read_ahead, channels, range);
+}
 
-  return process::make_read_adm_bw64(name, path, block_size);
+process::SampleFormat parse_sample_format(const std::string &format) {
+  using enum process::SampleFormat;
+  if (format == "int16") return Int16;
+  if (format == "int24") return Int24;
+  if (format == "int32") return Int32;
+  if (format == "float32") return Float32;
+  throw std::runtime_error("Config error: " + format +
+                           " is not a valid sample format, valid formats are \"int16\", \"int24\", \"int32\" and "
+                           "\"float32\"");
 }
 
 framework::ProcessPtr make_write_adm_bw64(nlohmann::json &config, const std::string &name) {
   std::string path = get<std::string>(config, "path");
+  size_t write_behind = get<size_t>(config, "write_behind", 0);
+  auto format = parse_sample_format(get<std::string>(config, "format", "int24"));
 
-  return process::make_write_adm_bw64(name, path);
+  return process::make_write_adm_bw64(name, path, write_behind, format);
 }
 
 framework::ProcessPtr make_write_bw64(nlohmann::json &config, const std::string &name) {
   std::string path = get<std::string>(config, "path");
+  size_t write_behind = get<size_t>(config, "write_behind", 0);
+  auto format = parse_sample_format(get<std::string>(config, "format", "int24"));
 
-  return process::make_write_bw64(name, path);
+  return process::make_write_bw64(name, path, write_behind, format);
 }
 
 framework::ProcessPtr make_remove_elements(nlohmann::json &config, const std::string &name) {
@@ -170,8 +198,9 @@ framework::ProcessPtr make_render(nlohmann::json &config, const std::string &nam
   auto layout_name = get<std::string>(config, "layout");
   auto layout = ear::getLayout(layout_name);
   size_t block_size = get<size_t>(config, "block_size", 1024);
+  size_t threads = get<size_t>(config, "threads", 1);
 
-  return render::make_render(name, layout, block_size);
+  return render::make_render(name, layout, block_size, {}, threads);
 }
 
 framework::ProcessPtr make_measure_loudness(nlohmann::json &config, const std::string &name) {
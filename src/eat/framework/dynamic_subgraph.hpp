@@ -1,4 +1,5 @@
 #pragma once
+#include <typeinfo>
 
 #include "eat/framework/evaluate.hpp"
 #include "eat/framework/process.hpp"
@@ -189,7 +190,10 @@ class DynamicSubgraph : public StreamingAtomicProcess {
     if (!our_port_t)
       throw std::runtime_error("data/stream port mismatch between inner/outer ports named " + process->name());
 
-    if (!our_port_t->compatible(process->port))
+    // items are moved directly between these ports, so they must have the
+    // same type, even if compatible() would allow a conversion
+    const Port &our_port_ref = *our_port_t, &inner_port_ref = *process->port;
+    if (typeid(our_port_ref) != typeid(inner_port_ref))
       throw std::runtime_error("inner/outer port named " + process->name() + " do not have the same type");
 
     ports_vec.emplace_back(our_port_t, process->port);
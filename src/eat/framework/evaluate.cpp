@@ -1,7 +1,17 @@
 #include "eat/framework/evaluate.hpp"
 
 #include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <set>
+#include <limits>
 #include <stdexcept>
+#include <thread>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
 #include <vector>
 
 #include "eat/framework/exceptions.hpp"
@@ -138,50 +148,48 @@ void validate(const Graph &g) {
   // - processes are loop-free
 }
 
-// given that processes in ran_start have been ran find all streaming processes
-// which could run, ignoring any processes that become active because of
-// non-streaming connections from processes not in ran_start
+// given that processes in ran_start have been ran, and the streaming processes
+// in start are runnable, find all streaming processes which could run,
+// ignoring any processes that become active because of non-streaming
+// connections from processes not in ran_start
 //
-// to_run_start is just the complement of ran_start, but generally this will be
-// available
-static std::set<ProcessPtr> runnable_streaming_processes(const Graph &g, const std::set<ProcessPtr> &ran_start,
-                                                         const std::set<ProcessPtr> &to_run_start) {
-  std::set<ProcessPtr> ran = ran_start;
-  std::set<ProcessPtr> runnable;
-  std::set<ProcessPtr> to_run = to_run_start;
-
-  auto update_runnable = [&]() {
-    runnable.clear();
-    for (auto &process : to_run) {
-      if (!is_streaming(process)) continue;
-
-      auto connections = input_connections(g, process);
-      bool all_inputs_ran = std::all_of(connections.begin(), connections.end(), [&](auto &connection) {
-        // only consider processes that are not part of the possible
-        // streaming subgraphs for non-streaming connections
-        if (connection.is_streaming())
-          return ran.find(connection.upstream_process) != ran.end();
-        else
-          return ran_start.find(connection.upstream_process) != ran_start.end();
-      });
-
-      if (all_inputs_ran) runnable.insert(process);
-    }
-  };
-
-  update_runnable();
-  always_assert(runnable.size(), "expected at least one runnable process");
-
+// this only visits processes reachable from start through streaming
+// connections
+static std::set<ProcessPtr> runnable_streaming_processes(const GraphIndex &index, const std::set<ProcessPtr> &ran_start,
+                                                         const std::set<ProcessPtr> &start) {
+  always_assert(start.size(), "expected at least one runnable process");
+
+  // for processes which have been seen, the number of streaming inputs which
+  // are not known to be runnable, or blocked if there is a non-streaming
+  // input which has not been ran
+  const size_t blocked = std::numeric_limits<size_t>::max();
+  std::unordered_map<ProcessPtr, size_t> n_waiting;
+
+  std::vector<ProcessPtr> to_visit(start.begin(), start.end());
   std::set<ProcessPtr> all_runnable;
 
-  while (runnable.size()) {
-    auto process = *runnable.begin();
-    ran.insert(process);
-    to_run.erase(process);
-
+  while (to_visit.size()) {
+    auto process = to_visit.back();
+    to_visit.pop_back();
     all_runnable.insert(process);
 
-    update_runnable();
+    for (auto &connection : index.output_connections(process)) {
+      if (!connection.is_streaming()) continue;
+
+      auto [it, inserted] = n_waiting.emplace(connection.downstream_process, 0);
+      if (inserted)
+        for (auto &input : index.input_connections(connection.downstream_process)) {
+          if (ran_start.find(input.upstream_process) != ran_start.end()) continue;
+          if (input.is_streaming()) {
+            it->second++;
+          } else {
+            it->second = blocked;
+            break;
+          }
+        }
+
+      if (it->second != blocked && --it->second == 0) to_visit.push_back(connection.downstream_process);
+    }
   }
 
   return all_runnable;
@@ -189,7 +197,7 @@ static std::set<ProcessPtr> runnable_streaming_processes(const Graph &g, const s
 
 // find processes connected by streaming connections, starting at 'start',
 // considering only processes in 'processes'
-static std::set<ProcessPtr> streaming_subgraph_from_set(const Graph &g, const std::set<ProcessPtr> &processes,
+static std::set<ProcessPtr> streaming_subgraph_from_set(const GraphIndex &index, const std::set<ProcessPtr> &processes,
                                                         const ProcessPtr &start) {
   std::set<ProcessPtr> out = {};
   // processes yet to be visited
@@ -201,7 +209,7 @@ static std::set<ProcessPtr> streaming_subgraph_from_set(const Graph &g, const st
 
     if (!out.insert(p).second) continue;
 
-    for (auto &connection : output_connections(g, p)) {
+    for (auto &connection : index.output_connections(p)) {
       if (!connection.is_streaming()) continue;
 
       if (processes.find(connection.downstream_process) == processes.end()) continue;
@@ -209,7 +217,7 @@ static std::set<ProcessPtr> streaming_subgraph_from_set(const Graph &g, const st
       if (out.find(connection.downstream_process) == out.end()) to_process.push_back(connection.downstream_process);
     }
 
-    for (auto &connection : input_connections(g, p)) {
+    for (auto &connection : index.input_connections(p)) {
       if (!connection.is_streaming()) continue;
 
       if (processes.find(connection.upstream_process) == processes.end()) continue;
@@ -223,14 +231,14 @@ static std::set<ProcessPtr> streaming_subgraph_from_set(const Graph &g, const st
 
 // find sets of processes connected by streaming connections, considering only
 // processes in 'processes'
-static std::set<std::set<ProcessPtr>> streaming_subgraphs_from_set(const Graph &g,
+static std::set<std::set<ProcessPtr>> streaming_subgraphs_from_set(const GraphIndex &index,
                                                                    const std::set<ProcessPtr> &processes) {
   std::set<std::set<ProcessPtr>> out;
   std::set<ProcessPtr> all_visited;
 
   for (auto &process : processes) {
     if (all_visited.find(process) == all_visited.end()) {
-      auto subgraph = streaming_subgraph_from_set(g, processes, process);
+      auto subgraph = streaming_subgraph_from_set(index, processes, process);
       all_visited.insert(subgraph.begin(), subgraph.end());
       out.insert(std::move(subgraph));
     }
@@ -240,68 +248,67 @@ static std::set<std::set<ProcessPtr>> streaming_subgraphs_from_set(const Graph &
 }
 
 /// are all connections from processes in subgraph to other processes in the subgraph?
-static bool is_complete_streaming_subgraph(const Graph &g, const std::set<ProcessPtr> &subgraph) {
+static bool is_complete_streaming_subgraph(const GraphIndex &index, const std::set<ProcessPtr> &subgraph) {
   for (auto &process : subgraph) {
-    for (auto &connection : output_connections(g, process))
+    for (auto &connection : index.output_connections(process))
       if (connection.is_streaming() && subgraph.find(connection.downstream_process) == subgraph.end()) return false;
-    for (auto &connection : input_connections(g, process))
+    for (auto &connection : index.input_connections(process))
       if (connection.is_streaming() && subgraph.find(connection.upstream_process) == subgraph.end()) return false;
   }
   return true;
 }
 
-static std::vector<std::set<ProcessPtr>> subgraphs_in_order(const Graph &g, bool allow_split = false) {
+static std::vector<std::set<ProcessPtr>> subgraphs_in_order(const GraphIndex &index, bool allow_split = false) {
+  const Graph &g = index.graph();
   std::vector<std::set<ProcessPtr>> out;
-  std::set<ProcessPtr> runnable;
-  std::set<ProcessPtr> to_run(g.get_processes().begin(), g.get_processes().end());
   std::set<ProcessPtr> ran;
 
-  auto update_runnable = [&]() {
-    runnable.clear();
-    for (auto &process : to_run) {
-      auto connections = input_connections(g, process);
-      bool all_inputs_ran = std::all_of(connections.begin(), connections.end(), [&](auto &connection) {
-        return ran.find(connection.upstream_process) != ran.end();
-      });
+  // processes which have not been ran, but all of their inputs have; the
+  // non-streaming ones are also kept separately, as these are ran first
+  std::set<ProcessPtr> runnable;
+  std::set<ProcessPtr> runnable_functional;
 
-      if (all_inputs_ran) runnable.insert(process);
-    }
+  // for each process which has not been ran, the number of input connections
+  // from processes which have not been ran
+  std::unordered_map<ProcessPtr, size_t> n_waiting;
+
+  auto make_runnable = [&](const ProcessPtr &process) {
+    runnable.insert(process);
+    if (!is_streaming(process)) runnable_functional.insert(process);
   };
 
-  update_runnable();
+  for (auto &process : g.get_processes()) {
+    size_t n = index.input_connections(process).size();
+    if (n_waiting.emplace(process, n).second && !n) make_runnable(process);
+  }
 
-  while (to_run.size()) {
-    always_assert(runnable.size(), "expected at least one runnable process");
+  size_t n_to_run = n_waiting.size();
 
-    ProcessPtr process_to_run;
-    for (auto &process : runnable) {
-      if (!is_streaming(process)) {
-        process_to_run = process;
-        break;
-      }
-    }
+  while (ran.size() < n_to_run) {
+    always_assert(runnable.size(), "expected at least one runnable process");
 
     std::set<ProcessPtr> subgraph_to_run;
     // if there is a runnable non-streaming processes, handle it normally
-    if (process_to_run)
-      subgraph_to_run = {process_to_run};
+    if (runnable_functional.size())
+      subgraph_to_run = {*runnable_functional.begin()};
     else {
       // otherwise, find connected streaming subgraphs whose non-streaming
       // inputs have all been ran. to do this:
       //
       // - find all streaming processes that could possibly run, assuming that
-      //   non-streaming connections are ignored (make list of runnable and
-      //   select one repeatedly, as above)
+      //   non-streaming connections are ignored (starting from the runnable
+      //   processes, follow streaming connections to processes whose inputs
+      //   are all either ran or runnable)
       // - split this into connected sub-graphs
       // - classify these as complete (no external streaming connections) or incomplete
       // - pick a complete one if possible. otherwise if allow_split, pick an incomplete one
-      std::set<ProcessPtr> runnable_streaming = runnable_streaming_processes(g, ran, to_run);
+      std::set<ProcessPtr> runnable_streaming = runnable_streaming_processes(index, ran, runnable);
       always_assert(runnable_streaming.size(), "found no runnable streaming processes");
-      auto subgraphs = streaming_subgraphs_from_set(g, runnable_streaming);
+      auto subgraphs = streaming_subgraphs_from_set(index, runnable_streaming);
       always_assert(runnable_streaming.size(), "found no streaming subgraphs");
 
       for (auto &subgraph : subgraphs)
-        if (is_complete_streaming_subgraph(g, subgraph)) {
+        if (is_complete_streaming_subgraph(index, subgraph)) {
           subgraph_to_run = subgraph;
           break;
         }
@@ -315,45 +322,245 @@ static std::vector<std::set<ProcessPtr>> subgraphs_in_order(const Graph &g, bool
 
     for (auto &process : subgraph_to_run) {
       ran.insert(process);
-      to_run.erase(process);
+      runnable.erase(process);
+      runnable_functional.erase(process);
     }
-    out.push_back(std::move(subgraph_to_run));
 
-    update_runnable();
+    // processes which are ran together can't be runnable as a result of each
+    // other, so update the counts after marking them all as ran
+    for (auto &process : subgraph_to_run)
+      for (auto &connection : index.output_connections(process)) {
+        auto it = n_waiting.find(connection.downstream_process);
+        if (it != n_waiting.end() && --it->second == 0 && ran.find(it->first) == ran.end())
+          make_runnable(it->first);
+      }
+
+    out.push_back(std::move(subgraph_to_run));
   }
 
   return out;
 }
 
 // adds ExecCopyData step to plan to copy/move data to all connected ports
-static void add_data_copy_to_plan(const Graph &g, std::vector<ExecStepPtr> &plan, const DataPortBasePtr &port) {
+// returns the ports which the added step copies to
+static std::vector<DataPortBasePtr> add_data_copy_to_plan(const GraphIndex &index, std::vector<ExecStepPtr> &plan,
+                                                          const DataPortBasePtr &port) {
   std::vector<DataPortBasePtr> ports;
-  for (auto &connected_port : connected_ports(g, port)) {
+  for (auto &connected_port : index.connected_ports(port)) {
     auto connected_port_data = checked_dynamic_pointer_cast<DataPortBase>(connected_port);
     ports.push_back(connected_port_data);
   }
 
   if (ports.size()) plan.push_back(std::make_shared<ExecCopyData>(port, ports));
+  return ports;
+}
+
+/// replace streaming processes which can read their streaming input directly
+/// from where the data comes from, removing the processes which would have
+/// produced it (see StreamingAtomicProcess::passthrough)
+///
+/// returns a new graph, which may need flattening
+static Graph apply_passthroughs(const Graph &g) {
+  GraphIndex index(g);
+
+  // replacements for downstream processes, and the upstream processes which
+  // are no longer needed
+  std::unordered_map<ProcessPtr, ProcessPtr> replacements;
+  std::set<ProcessPtr> removed;
+
+  for (auto &process : g.get_processes()) {
+    auto streaming_process = std::dynamic_pointer_cast<StreamingAtomicProcess>(process);
+    if (!streaming_process) continue;
+
+    std::vector<Connection> streaming_inputs;
+    for (auto &connection : index.input_connections(process))
+      if (connection.is_streaming()) streaming_inputs.push_back(connection);
+    if (streaming_inputs.size() != 1) continue;
+    auto &connection = streaming_inputs.front();
+
+    // the upstream process must have nothing else to do once removed
+    auto upstream = checked_dynamic_pointer_cast<StreamingAtomicProcess>(connection.upstream_process);
+    if (index.input_connections(upstream).size() || index.output_connections(upstream).size() != 1) continue;
+
+    auto source = upstream->passthrough_source(connection.upstream_port->name());
+    if (!source) continue;
+
+    auto replacement = streaming_process->passthrough(process->name(), connection.downstream_port->name(), *source);
+    if (!replacement) continue;
+
+    replacements.emplace(process, replacement);
+    removed.insert(upstream);
+  }
+
+  if (replacements.empty()) return g;
+
+  auto replaced = [&](const ProcessPtr &process) {
+    auto it = replacements.find(process);
+    return it != replacements.end() ? it->second : process;
+  };
+
+  Graph new_g;
+  for (auto &process : g.get_processes())
+    if (removed.find(process) == removed.end()) new_g.register_process(replaced(process));
+
+  // connect ports with the same names on the replacements
+  for (auto &process : g.get_processes())
+    for (auto &connection : index.input_connections(process)) {
+      if (removed.find(connection.upstream_process) != removed.end()) continue;
+
+      PortPtr upstream_port = connection.upstream_port;
+      if (replacements.count(connection.upstream_process))
+        upstream_port = replaced(connection.upstream_process)->get_out_port(upstream_port->name());
+
+      PortPtr downstream_port = connection.downstream_port;
+      if (replacements.count(process)) downstream_port = replaced(process)->get_in_port(downstream_port->name());
+
+      new_g.connect(upstream_port, downstream_port);
+    }
+
+  return new_g;
+}
+
+/// insert converters between connected streaming ports with different types
+/// (see ConvertStream)
+///
+/// an output connected to several inputs with the same type is converted once
+///
+/// returns a new graph, which may need flattening
+static Graph insert_conversions(const Graph &g) {
+  // converters for each connection which needs one, by downstream port
+  std::map<PortPtr, ProcessPtr> connection_converters;
+  // converters by upstream port and the type of the downstream port
+  std::map<std::pair<PortPtr, std::type_index>, ProcessPtr> converters;
+
+  for (auto &[downstream_port, upstream_port] : g.get_port_inputs()) {
+    auto upstream_stream = std::dynamic_pointer_cast<StreamPortBase>(upstream_port);
+    auto downstream_stream = std::dynamic_pointer_cast<StreamPortBase>(downstream_port);
+    if (!upstream_stream || !downstream_stream) continue;
+
+    const StreamPortBase &downstream_ref = *downstream_stream;
+    auto key = std::make_pair(upstream_port, std::type_index(typeid(downstream_ref)));
+    auto it = converters.find(key);
+    if (it == converters.end()) {
+      ProcessPtr converter = upstream_stream->get_converter("convert " + upstream_port->name(), downstream_ref);
+      if (!converter) continue;
+      it = converters.emplace(key, converter).first;
+    }
+    connection_converters.emplace(downstream_port, it->second);
+  }
+
+  if (connection_converters.empty()) return g;
+
+  Graph new_g;
+  for (auto &process : g.get_processes()) new_g.register_process(process);
+
+  for (auto &[key, converter] : converters) {
+    new_g.register_process(converter);
+    new_g.connect(key.first, converter->get_in_port("in"));
+  }
+
+  for (auto &[downstream_port, upstream_port] : g.get_port_inputs()) {
+    auto it = connection_converters.find(downstream_port);
+    if (it != connection_converters.end())
+      new_g.connect(it->second->get_out_port("out"), downstream_port);
+    else
+      new_g.connect(upstream_port, downstream_port);
+  }
+
+  return new_g;
 }
 
+/// makes copies of streaming processes and the processes upstream of them (see
+/// StreamingAtomicProcess::duplicate), to break streaming connections between
+/// subgraphs without buffering
+class Duplicator {
+ public:
+  Duplicator(const GraphIndex &index_, Graph &new_g_) : index(index_), new_g(new_g_) {}
+
+  /// can process, and all processes upstream of it through streaming
+  /// connections, be duplicated?
+  bool can_duplicate(const ProcessPtr &process) {
+    auto it = can_duplicate_.find(process);
+    if (it != can_duplicate_.end()) return it->second;
+
+    bool result = true;
+
+    // processes with other streaming outputs are not duplicated, as nothing
+    // would read from them
+    auto streaming_process = std::dynamic_pointer_cast<StreamingAtomicProcess>(process);
+    size_t n_streaming_outputs = 0;
+    if (streaming_process)
+      for (auto &[name, port] : process->get_out_port_map())
+        if (is_streaming(port)) n_streaming_outputs++;
+    if (n_streaming_outputs != 1 || !streaming_process->is_duplicable()) result = false;
+
+    for (auto &connection : index.input_connections(process))
+      if (result && connection.is_streaming()) result = can_duplicate(connection.upstream_process);
+
+    can_duplicate_.emplace(process, result);
+    return result;
+  }
+
+  /// get a duplicate of process to run in the subgraph with index subgraph,
+  /// adding it and any upstream duplicates to new_g
+  ///
+  /// can_duplicate(process) must be true
+  ProcessPtr get_duplicate(const ProcessPtr &process, size_t subgraph) {
+    auto it = duplicates.find({process, subgraph});
+    if (it != duplicates.end()) return it->second;
+
+    auto streaming_process = checked_dynamic_pointer_cast<StreamingAtomicProcess>(process);
+    ProcessPtr duplicate = streaming_process->duplicate(process->name() + " (duplicate)");
+    always_assert(duplicate != nullptr, "process " + process->name() + " is duplicable but was not duplicated");
+    new_g.register_process(duplicate);
+    duplicates.emplace(std::make_pair(process, subgraph), duplicate);
+
+    // streaming inputs come from duplicates of the upstream processes, while
+    // non-streaming inputs are shared with the original
+    for (auto &connection : index.input_connections(process)) {
+      auto in_port = duplicate->get_in_port(connection.downstream_port->name());
+      if (connection.is_streaming()) {
+        auto upstream = get_duplicate(connection.upstream_process, subgraph);
+        new_g.connect(upstream->get_out_port(connection.upstream_port->name()), in_port);
+      } else
+        new_g.connect(connection.upstream_port, in_port);
+    }
+
+    return duplicate;
+  }
+
+ private:
+  const GraphIndex &index;
+  Graph &new_g;
+  std::unordered_map<ProcessPtr, bool> can_duplicate_;
+  std::map<std::pair<ProcessPtr, size_t>, ProcessPtr> duplicates;
+};
+
 /// given some subgraphs to run, add extra processes to eliminate streaming
 /// connections between subgraphs
 ///
 /// returns a new graph with the new connections and processes, which may need flattening
-static Graph augment_subgraphs(const Graph &g, const std::vector<std::set<ProcessPtr>> &subgraphs) {
+///
+/// memory_budget is shared by all buffer writers
+static Graph augment_subgraphs(const GraphIndex &index, const std::vector<std::set<ProcessPtr>> &subgraphs,
+                               const MemoryBudgetPtr &memory_budget) {
+  const Graph &g = index.graph();
   Graph new_g;
   for (auto &process : g.get_processes()) new_g.register_process(process);
 
   // all connections in the new graph, kept separately so that we can remove them
   std::map<PortPtr, PortPtr> new_connections = g.get_port_inputs();
 
-  auto find_subgraph = [&](const ProcessPtr &process) {
-    for (size_t i = 0; i < subgraphs.size(); i++) {
-      auto &subgraph = subgraphs.at(i);
-      if (subgraph.find(process) != subgraph.end()) return i;
-    }
+  std::unordered_map<ProcessPtr, size_t> subgraph_for_process;
+  for (size_t i = 0; i < subgraphs.size(); i++)
+    for (auto &process : subgraphs[i]) subgraph_for_process.emplace(process, i);
+
+  Duplicator duplicator(index, new_g);
 
-    throw AssertionError("could not find subgraph for process");
+  auto find_subgraph = [&](const ProcessPtr &process) {
+    auto it = subgraph_for_process.find(process);
+    if (it == subgraph_for_process.end()) throw AssertionError("could not find subgraph for process");
+    return it->second;
   };
 
   for (auto &subgraph : subgraphs)
@@ -361,7 +568,7 @@ static Graph augment_subgraphs(const Graph &g, const std::vector<std::set<Proces
       for (auto &[out_port_name, out_port] : process->get_out_port_map()) {
         // get connections from this port to other subgraphs (by index)
         std::map<size_t, std::vector<Connection>> connections_by_subgraph;
-        for (auto &connection : output_connections(g, process)) {
+        for (auto &connection : index.output_connections(process)) {
           if (connection.upstream_port != out_port) continue;
 
           // non-streaming or connection in same subgraph -> handle as normal
@@ -377,12 +584,20 @@ static Graph augment_subgraphs(const Graph &g, const std::vector<std::set<Proces
           new_connections.erase(connection.downstream_port);
         }
 
-        // if streaming connections to other subgraphs were found, introduce
-        // converters between streaming and non-streaming
-        if (connections_by_subgraph.size()) {
+        // if streaming connections to other subgraphs were found, either run
+        // a duplicate of this process and its upstream processes in each
+        // subgraph, or introduce converters between streaming and
+        // non-streaming
+        if (connections_by_subgraph.size() && duplicator.can_duplicate(process)) {
+          for (auto &[other_subgraph, connections] : connections_by_subgraph) {
+            auto duplicate = duplicator.get_duplicate(process, other_subgraph);
+            for (auto &connection : connections)
+              new_g.connect(duplicate->get_out_port(out_port_name), connection.downstream_port);
+          }
+        } else if (connections_by_subgraph.size()) {
           auto out_port_stream = checked_dynamic_pointer_cast<StreamPortBase>(out_port);
 
-          ProcessPtr writer = out_port_stream->get_buffer_writer("buffer writer");
+          ProcessPtr writer = out_port_stream->get_buffer_writer("buffer writer", memory_budget);
           new_g.register_process(writer);
 
           new_g.connect(out_port, writer->get_in_port("in"));
@@ -407,10 +622,10 @@ static Graph augment_subgraphs(const Graph &g, const std::vector<std::set<Proces
 
 // within each subgraph, check that all streaming connections are internal, and all non-streaming connections
 // are external
-static void check_subgraph_connections(const Graph &g, const std::vector<std::set<ProcessPtr>> &subgraphs) {
+static void check_subgraph_connections(const GraphIndex &index, const std::vector<std::set<ProcessPtr>> &subgraphs) {
   for (auto &subgraph : subgraphs)
     for (auto &process : subgraph)
-      for (auto &connection : output_connections(g, process))
+      for (auto &connection : index.output_connections(process))
         if (connection.is_streaming())
           always_assert(subgraph.find(connection.downstream_process) != subgraph.end(),
                         "found streaming connection out of subgraph");
@@ -419,44 +634,160 @@ static void check_subgraph_connections(const Graph &g, const std::vector<std::se
                         "found non-streaming connection inside subgraph");
 }
 
-Plan plan(const Graph &g) {
+Plan plan(const Graph &g, const PlanOptions &options) {
   validate(g);
-  Graph flat = flatten(g);
-
-  std::vector<std::set<ProcessPtr>> subgraphs = subgraphs_in_order(flat, /* allow_split = */ true);
+  Graph flat = flatten(insert_conversions(apply_passthroughs(flatten(g))));
+
+  {
+    GraphIndex index(flat);
+    auto subgraphs = subgraphs_in_order(index, /* allow_split = */ true);
+    auto memory_budget = std::make_shared<MemoryBudget>(options.buffer_memory);
+    Graph augmented = augment_subgraphs(index, subgraphs, memory_budget);
+    flat = flatten(augmented);
+  }
 
-  flat = flatten(augment_subgraphs(flat, subgraphs));
-  subgraphs = subgraphs_in_order(flat);
+  GraphIndex index(flat);
+  std::vector<std::set<ProcessPtr>> subgraphs = subgraphs_in_order(index);
 
-  check_subgraph_connections(flat, subgraphs);
+  check_subgraph_connections(index, subgraphs);
 
   std::vector<ExecStepPtr> plan;
+  std::vector<std::vector<size_t>> dependencies;
+  // for each data input port, the index of the step which copies into it
+  std::map<PortPtr, size_t> port_copy_step;
 
   for (auto &subgraph : subgraphs) {
+    std::vector<size_t> subgraph_dependencies;
+    for (auto &process : subgraph)
+      for (auto &[port_name, port] : process->get_in_port_map())
+        if (std::dynamic_pointer_cast<DataPortBase>(port)) {
+          auto it = port_copy_step.find(port);
+          always_assert(it != port_copy_step.end(), "data input port is not written by an earlier step");
+          if (std::find(subgraph_dependencies.begin(), subgraph_dependencies.end(), it->second) ==
+              subgraph_dependencies.end())
+            subgraph_dependencies.push_back(it->second);
+        }
+    std::sort(subgraph_dependencies.begin(), subgraph_dependencies.end());
+
+    size_t subgraph_step = plan.size();
+    dependencies.push_back(std::move(subgraph_dependencies));
+
     if (!is_streaming(*subgraph.begin())) {
       always_assert(subgraph.size() == 1, "non-streaming subgraphs should only have one process");
       const ProcessPtr &process = *subgraph.begin();
 
       auto atomic_process = checked_dynamic_pointer_cast<FunctionalAtomicProcess>(process);
-      plan.push_back(std::make_shared<ExecFunctional>(atomic_process));
+      ProcessProfile *profile = options.profiler ? &options.profiler->add_process(atomic_process->name()) : nullptr;
+      plan.push_back(std::make_shared<ExecFunctional>(atomic_process, profile));
     } else {
-      plan.push_back(std::make_shared<ExecStreamingSubgraph>(flat, subgraph));
+      plan.push_back(std::make_shared<ExecStreamingSubgraph>(index, subgraph, options.threaded_streaming,
+                                                             options.profiler.get()));
     }
 
     // add output data copies
     for (auto &process : subgraph)
       for (auto &[port_name, port] : process->get_out_port_map()) {
         auto data_port = std::dynamic_pointer_cast<DataPortBase>(port);
-        if (data_port) add_data_copy_to_plan(flat, plan, data_port);
+        if (data_port) {
+          auto copied_to = add_data_copy_to_plan(index, plan, data_port);
+          if (copied_to.size()) {
+            dependencies.push_back({subgraph_step});
+            for (auto &copied_to_port : copied_to) port_copy_step[copied_to_port] = plan.size() - 1;
+          }
+        }
       }
   }
 
-  return {std::move(flat), std::move(plan)};
+  Plan p{std::move(flat), std::move(plan), std::move(dependencies)};
+  if (options.profiler) p.set_profiler(options.profiler);
+  return p;
 }
 
-void evaluate(const Graph &g) {
-  Plan p = plan(g);
+void evaluate(const Graph &g, const PlanOptions &options) {
+  Plan p = plan(g, options);
   p.run();
 }
 
+static std::vector<std::vector<size_t>> sequential_dependencies(size_t n_steps) {
+  std::vector<std::vector<size_t>> dependencies(n_steps);
+  for (size_t i = 1; i < n_steps; i++) dependencies[i].push_back(i - 1);
+  return dependencies;
+}
+
+Plan::Plan(Graph graph, std::vector<ExecStepPtr> steps)
+    : graph_(std::move(graph)), steps_(std::move(steps)), dependencies_(sequential_dependencies(steps_.size())) {}
+
+Plan::Plan(Graph graph, std::vector<ExecStepPtr> steps, std::vector<std::vector<size_t>> dependencies)
+    : graph_(std::move(graph)), steps_(std::move(steps)), dependencies_(std::move(dependencies)) {
+  always_assert(dependencies_.size() == steps_.size(), "must have dependencies for each step");
+  for (size_t i = 0; i < dependencies_.size(); i++)
+    for (size_t dependency : dependencies_[i])
+      always_assert(dependency < i, "steps must only depend on earlier steps");
+}
+
+void Plan::set_profiler(const std::shared_ptr<Profiler> &profiler) {
+  profiler_ = profiler;
+  step_profiles_.clear();
+  if (profiler_)
+    for (auto &step : steps_) step_profiles_.push_back(&profiler_->add_step(step->description()));
+}
+
+void Plan::run_parallel(size_t n_threads) {
+  if (n_threads <= 1) {
+    run();
+    return;
+  }
+
+  // number of unfinished dependencies for each step, and the reverse mapping
+  std::vector<size_t> n_waiting(steps_.size());
+  std::vector<std::vector<size_t>> dependents(steps_.size());
+  for (size_t i = 0; i < steps_.size(); i++) {
+    n_waiting[i] = dependencies_[i].size();
+    for (size_t dependency : dependencies_[i]) dependents[dependency].push_back(i);
+  }
+
+  // steps which can be started; ordered so that earlier steps are preferred
+  std::set<size_t> ready;
+  for (size_t i = 0; i < steps_.size(); i++)
+    if (!n_waiting[i]) ready.insert(i);
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::exception_ptr error;
+  size_t n_finished = 0;
+
+  auto worker = [&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      cv.wait(lock, [&]() { return error || n_finished == steps_.size() || ready.size(); });
+      if (error || n_finished == steps_.size()) return;
+
+      size_t step_idx = *ready.begin();
+      ready.erase(ready.begin());
+
+      lock.unlock();
+      try {
+        profile_call(step_profile(step_idx), [&]() { steps_[step_idx]->run(); });
+      } catch (...) {
+        lock.lock();
+        if (!error) error = std::current_exception();
+        cv.notify_all();
+        return;
+      }
+      lock.lock();
+
+      n_finished++;
+      for (size_t dependent : dependents[step_idx])
+        if (--n_waiting[dependent] == 0) ready.insert(dependent);
+      cv.notify_all();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < std::min(n_threads, steps_.size()); i++) threads.emplace_back(worker);
+  for (auto &thread : threads) thread.join();
+
+  if (error) std::rethrow_exception(error);
+}
+
 }  // namespace eat::framework
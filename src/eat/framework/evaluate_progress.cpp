@@ -13,6 +13,8 @@ namespace eat::framework {
 ///   within the streaming subgraph can optionally report its progress (if
 ///   it's known, for example when reading a file), and these are averaged to
 ///   find the progress within this step
+/// - threaded streaming subgraphs run on their own threads, and the progress
+///   is checked periodically while they run
 ///
 /// see RefreshWindow for a description of the actual update mechanism
 void run_with_progress(const Plan &p) {
@@ -33,22 +35,30 @@ void run_with_progress(const Plan &p) {
       format_progress(msg, width, overall_progress, current_task, 0.0f);
       window.print(msg);
 
-      streaming_step->run_initialise();
-
-      do {
-        streaming_step->run_run();
-
+      auto print_progress = [&]() {
         auto progress = streaming_step->get_progress();
         format_progress(msg, width, overall_progress, current_task, progress.value_or(0.0f));
         window.print(msg);
-      } while (streaming_step->runnable());
+      };
+
+      profile_call(p.step_profile(step_i), [&]() {
+        streaming_step->run_initialise();
+
+        if (streaming_step->threaded())
+          streaming_step->run_threaded(print_progress);
+        else
+          do {
+            streaming_step->run_run();
+            print_progress();
+          } while (streaming_step->runnable());
 
-      streaming_step->run_finalise();
+        streaming_step->run_finalise();
+      });
     } else {
       format_progress(msg, width, overall_progress, step->description(), 0.0f);
       window.print(msg);
 
-      step->run();
+      profile_call(p.step_profile(step_i), [&]() { step->run(); });
     }
   }
 
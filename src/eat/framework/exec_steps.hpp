@@ -1,6 +1,14 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
 
 #include "eat/framework/evaluate.hpp"
 #include "utilities.hpp"
@@ -9,26 +17,95 @@ namespace eat::framework {
 
 class ExecFunctional : public ExecStep {
  public:
-  ExecFunctional(FunctionalAtomicProcessPtr process_) noexcept : process(std::move(process_)) {}
+  ExecFunctional(FunctionalAtomicProcessPtr process_, ProcessProfile *profile_ = nullptr) noexcept
+      : process(std::move(process_)), profile(profile_) {}
 
-  virtual void run() override { process->process(); }
+  virtual void run() override {
+    profile_call(profile ? &profile->process : nullptr, [&]() { process->process(); });
+  }
 
   virtual std::string description() override { return process->name(); }
 
  private:
   FunctionalAtomicProcessPtr process;
+  ProcessProfile *profile;
 };
 
+/// calls to a streaming process; run() calls process()
+///
+/// if profile is not null, the time taken by each call and the items passing
+/// through each stream port are recorded in it
 class ExecStreaming : public ExecStep {
  public:
-  ExecStreaming(StreamingAtomicProcessPtr process_) noexcept : process(std::move(process_)) {}
+  ExecStreaming(StreamingAtomicProcessPtr process_, ProcessProfile *profile_ = nullptr)
+      : process(std::move(process_)), profile(profile_) {
+    if (profile) {
+      for (auto &[name, port] : process->get_in_port_map())
+        if (auto stream_port = std::dynamic_pointer_cast<StreamPortBase>(port))
+          in_ports.push_back({stream_port, &profile->in_ports[name]});
+      for (auto &[name, port] : process->get_out_port_map())
+        if (auto stream_port = std::dynamic_pointer_cast<StreamPortBase>(port))
+          out_ports.push_back({stream_port, &profile->out_ports[name]});
+    }
+  }
+
+  void initialise() {
+    profile_call(profile ? &profile->initialise : nullptr, [&]() { process->initialise(); });
+  }
+
+  virtual void run() override {
+    if (!profile) {
+      process->process();
+      return;
+    }
+
+    for (auto &port : in_ports) {
+      port.record_before();
+      port.profile->max_queued = std::max(port.profile->max_queued, port.size);
+    }
+    for (auto &port : out_ports) port.record_before();
+
+    profile_call(&profile->process, [&]() { process->process(); });
+
+    // inputs only shrink and outputs only grow while process() is running
+    for (auto &port : in_ports) {
+      port.profile->items += port.size - port.port->size();
+      port.profile->samples += port.samples - port.port->sample_count();
+    }
+    for (auto &port : out_ports) {
+      size_t size = port.port->size();
+      port.profile->items += size - port.size;
+      port.profile->samples += port.port->sample_count() - port.samples;
+      port.profile->max_queued = std::max(port.profile->max_queued, size);
+    }
+  }
 
-  virtual void run() override { process->process(); }
+  void finalise() {
+    profile_call(profile ? &profile->finalise : nullptr, [&]() { process->finalise(); });
+  }
 
   virtual std::string description() override { return process->name(); }
 
+  const StreamingAtomicProcessPtr &get_process() const { return process; }
+
  private:
   StreamingAtomicProcessPtr process;
+  ProcessProfile *profile;
+
+  /// a port being profiled, and its state before calling process()
+  struct ProfiledPort {
+    StreamPortBasePtr port;
+    PortProfile *profile;
+    size_t size = 0;
+    size_t samples = 0;
+
+    void record_before() {
+      size = port->size();
+      samples = port->sample_count();
+    }
+  };
+  std::vector<ProfiledPort> in_ports;
+  std::vector<ProfiledPort> out_ports;
 };
 
 class ExecCopyData : public ExecStep {
@@ -57,6 +134,8 @@ class ExecCopyStream : public ExecStep {
   ExecCopyStream(StreamPortBasePtr output_port_, std::vector<StreamPortBasePtr> input_ports_)
       : output_port(std::move(output_port_)), input_ports(std::move(input_ports_)) {
     always_assert(input_ports.size(), "must have at least 1 input port");
+    // move into a port which may modify the items, and copy into the rest
+    std::stable_partition(input_ports.begin(), input_ports.end(), [](auto &port) { return port->read_only(); });
   }
 
   virtual void run() override {
@@ -75,9 +154,10 @@ class ExecCopyStream : public ExecStep {
 };
 
 // adds ExecCopyStream step to plan to copy/move data to all connected ports
-inline void add_stream_copy_to_plan(const Graph &g, std::vector<ExecStepPtr> &plan, const StreamPortBasePtr &port) {
+inline void add_stream_copy_to_plan(const GraphIndex &index, std::vector<ExecStepPtr> &plan,
+                                    const StreamPortBasePtr &port) {
   std::vector<StreamPortBasePtr> ports;
-  for (auto &connected_port : connected_ports(g, port)) {
+  for (auto &connected_port : index.connected_ports(port)) {
     auto connected_port_stream = checked_dynamic_pointer_cast<StreamPortBase>(connected_port);
     ports.push_back(connected_port_stream);
   }
@@ -85,45 +165,99 @@ inline void add_stream_copy_to_plan(const Graph &g, std::vector<ExecStepPtr> &pl
   if (ports.size()) plan.push_back(std::make_shared<ExecCopyStream>(port, ports));
 }
 
+/// run a set of streaming processes connected together
+///
+/// by default this calls process() on each process in turn (in topological
+/// order) until all ports are closed. in threaded mode, each process is
+/// instead ran on its own thread; items pushed by a process are copied into
+/// staging ports belonging to the downstream processes, which are moved into
+/// their real input ports before process() is called, so a process never sees
+/// its ports change while it is running
+///
+/// in both modes, a process is not ran while any of the input ports it writes
+/// to are full (see StreamPortBase), unless no other process is able to make
+/// progress
 class ExecStreamingSubgraph : public ExecStep {
  public:
-  ExecStreamingSubgraph(const Graph &g, const std::set<ProcessPtr> &subgraph) {
-    std::set<ProcessPtr> to_run = subgraph;
-    std::set<ProcessPtr> ran;
-
-    auto pick_runnable = [&]() {
-      for (auto &process : to_run) {
-        bool inputs_ran = true;
-        for (auto &connection : input_connections(g, process)) {
-          if (connection.is_streaming() && ran.find(connection.upstream_process) == ran.end()) {
-            inputs_ran = false;
-            break;
-          }
-        }
-
-        if (inputs_ran) return process;
-      }
-      throw AssertionError("could not find runnable process");
+  /// if profiler is not null, each process is added to it and profiled
+  ExecStreamingSubgraph(const GraphIndex &index, const std::set<ProcessPtr> &subgraph, bool threaded = false,
+                        Profiler *profiler = nullptr)
+      : threaded_(threaded) {
+    // pick processes whose streaming inputs have all been picked, preferring
+    // processes with only read-only streaming inputs, so that they have
+    // finished with shared items before any process which modifies them runs
+    //
+    // n_waiting holds the number of streaming inputs of each process which
+    // have not been picked; once this reaches 0 the process is moved to one of
+    // the ready sets
+    std::map<ProcessPtr, size_t> n_waiting;
+    std::set<ProcessPtr> ready_read_only;
+    std::set<ProcessPtr> ready_other;
+
+    auto make_ready = [&](const ProcessPtr &process) {
+      bool read_only = true;
+      for (auto &connection : index.input_connections(process))
+        if (connection.is_streaming() && !connection.downstream_port->read_only()) read_only = false;
+      (read_only ? ready_read_only : ready_other).insert(process);
     };
 
-    while (to_run.size()) {
-      auto process = pick_runnable();
-      ran.insert(process);
-      to_run.erase(process);
+    for (auto &process : subgraph) {
+      size_t n = 0;
+      for (auto &connection : index.input_connections(process))
+        if (connection.is_streaming()) n++;
+      n_waiting[process] = n;
+      if (!n) make_ready(process);
+    }
+
+    for (size_t i = 0; i < subgraph.size(); i++) {
+      auto &ready = ready_read_only.size() ? ready_read_only : ready_other;
+      if (!ready.size()) throw AssertionError("could not find runnable process");
+      ProcessPtr process = *ready.begin();
+      ready.erase(ready.begin());
+
+      for (auto &connection : index.output_connections(process))
+        if (connection.is_streaming()) {
+          auto it = n_waiting.find(connection.downstream_process);
+          if (it != n_waiting.end() && --it->second == 0) make_ready(it->first);
+        }
 
       auto streaming_process = checked_dynamic_pointer_cast<StreamingAtomicProcess>(process);
 
       processes.push_back(streaming_process);
 
-      plan.push_back(std::make_shared<ExecStreaming>(streaming_process));
+      Stage stage;
+      stage.process = std::make_shared<ExecStreaming>(
+          streaming_process, profiler ? &profiler->add_process(streaming_process->name()) : nullptr);
+
+      for (auto &[name, port] : process->get_in_port_map())
+        if (auto streaming_port = std::dynamic_pointer_cast<StreamPortBase>(port))
+          stage.in_ports.push_back(streaming_port);
 
       // add copies to plan for output ports
       for (auto &[name, port] : process->get_out_port_map()) {
         auto streaming_port = std::dynamic_pointer_cast<StreamPortBase>(port);
         if (streaming_port) {
-          add_stream_copy_to_plan(g, plan, streaming_port);
+          stage.out_ports.push_back(streaming_port);
+          add_stream_copy_to_plan(index, stage.copies, streaming_port);
+          for (auto &connected_port : index.connected_ports(streaming_port))
+            stage.downstream_ports.push_back(checked_dynamic_pointer_cast<StreamPortBase>(connected_port));
         }
       }
+
+      stages.push_back(std::move(stage));
+    }
+
+    {
+      std::map<ProcessPtr, size_t> stage_idx;
+      for (size_t i = 0; i < processes.size(); i++) stage_idx[processes[i]] = i;
+
+      for (size_t i = 0; i < stages.size(); i++)
+        for (auto &connection : index.output_connections(processes[i]))
+          if (connection.is_streaming()) {
+            size_t idx = stage_idx.at(connection.downstream_process);
+            auto &downstream = stages[i].downstream_stages;
+            if (std::find(downstream.begin(), downstream.end(), idx) == downstream.end()) downstream.push_back(idx);
+          }
     }
 
     // populate ports
@@ -132,30 +266,140 @@ class ExecStreamingSubgraph : public ExecStep {
         auto streaming_port = std::dynamic_pointer_cast<StreamPortBase>(port);
         if (streaming_port) ports.push_back(streaming_port);
       }
+
+    if (threaded_) setup_workers(index);
   }
 
   void run_initialise() {
-    for (auto &process : processes) process->initialise();
+    for (auto &stage : stages) {
+      stage.ready = true;
+      stage.closed_sent.assign(stage.out_ports.size(), false);
+    }
+    ignore_full = false;
+    first_open_port = 0;
+
+    for (auto &stage : stages) stage.process->initialise();
   }
 
+  /// call process() once on each ready process which is not blocked by a full
+  /// downstream port, copying the outputs after each
+  ///
+  /// a process is ready if it has not been called yet, if new items were
+  /// copied into its inputs or they were closed, if it consumed or produced
+  /// anything on its last call, or if it has no streaming inputs and has not
+  /// closed all of its outputs. other processes would not do anything if they
+  /// were called, so are skipped. if no process is ready but some ports are
+  /// still open, all processes are called on the next pass
+  ///
+  /// if some processes were blocked and nothing changed, back-pressure is
+  /// ignored on the next call, so that graphs where a process needs more items
+  /// than the capacity of a port on another path can not deadlock
   void run_run() {
-    for (auto &step : plan) step->run();
+    bool any_ran = false;
+    bool any_blocked = false;
+    bool any_progress = false;
+
+    for (auto &stage : stages) {
+      if (!stage.ready) continue;
+
+      if (!ignore_full && any_full(stage.downstream_ports)) {
+        any_blocked = true;
+        continue;
+      }
+
+      any_ran = true;
+      size_t in_size_before = total_size(stage.in_ports);
+      stage.process->run();
+
+      bool consumed = total_size(stage.in_ports) != in_size_before;
+      bool produced = false;
+      for (size_t i = 0; i < stage.out_ports.size(); i++) {
+        if (stage.out_ports[i]->size()) produced = true;
+        if (stage.out_ports[i]->eof_triggered() && !stage.closed_sent[i]) {
+          produced = true;
+          stage.closed_sent[i] = true;
+        }
+      }
+
+      for (auto &copy : stage.copies) copy->run();
+
+      if (produced)
+        for (auto idx : stage.downstream_stages) stages[idx].ready = true;
+
+      stage.ready = consumed || produced || (stage.in_ports.empty() && !all_eof_triggered(stage.out_ports));
+      if (consumed || produced) any_progress = true;
+    }
+
+    ignore_full = any_blocked && !any_progress;
+
+    if (!any_ran && !any_blocked)
+      for (auto &stage : stages) stage.ready = true;
   }
 
   void run_finalise() {
-    for (auto &process : processes) process->finalise();
+    for (auto &stage : stages) stage.process->finalise();
   }
 
+  /// are any ports still open?
+  ///
+  /// once a port is at eof it stays there, so this only checks ports from the
+  /// first one which was open last time
   bool runnable() {
-    return std::any_of(ports.begin(), ports.end(), [](auto &port) { return !port->eof(); });
+    while (first_open_port < ports.size() && ports[first_open_port]->eof()) first_open_port++;
+    return first_open_port < ports.size();
+  }
+
+  bool threaded() const { return threaded_; }
+
+  /// run the processes on their own threads until all ports are closed; this
+  /// is the threaded equivalent of calling run_run() while runnable()
+  ///
+  /// update_progress is called periodically from the calling thread while
+  /// the processes are running
+  void run_threaded(const std::function<void()> &update_progress = {}) {
+    always_assert(threaded_, "run_threaded called on non-threaded subgraph");
+
+    error = nullptr;
+    n_finished = 0;
+    for (auto &worker : workers) {
+      worker->pending = false;
+      worker->waiting = false;
+      worker->wait_for_input = false;
+      worker->finished = false;
+      worker->progress = -1.0f;
+    }
+
+    std::vector<std::thread> threads;
+    for (auto &worker : workers) threads.emplace_back([this, &worker]() { run_worker(*worker); });
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      auto done = [&]() { return error || n_finished == workers.size(); };
+      while (!done()) {
+        if (update_progress) {
+          finished_cv.wait_for(lock, std::chrono::milliseconds(100), done);
+          lock.unlock();
+          update_progress();
+          lock.lock();
+        } else
+          finished_cv.wait(lock, done);
+      }
+    }
+
+    for (auto &thread : threads) thread.join();
+
+    if (error) std::rethrow_exception(error);
   }
 
   virtual void run() override {
     run_initialise();
 
-    do {
-      run_run();
-    } while (runnable());
+    if (threaded_)
+      run_threaded();
+    else
+      do {
+        run_run();
+      } while (runnable());
 
     run_finalise();
   }
@@ -174,8 +418,16 @@ class ExecStreamingSubgraph : public ExecStep {
     float total = 0.0f;
     int n = 0;
 
-    for (auto &process : processes) {
-      auto process_progress = process->get_progress();
+    for (size_t i = 0; i < processes.size(); i++) {
+      // in threaded mode the processes are busy on other threads, so use the
+      // progress they last reported
+      std::optional<float> process_progress;
+      if (threaded_) {
+        float progress = workers[i]->progress;
+        if (progress >= 0.0f) process_progress = progress;
+      } else
+        process_progress = processes[i]->get_progress();
+
       if (process_progress) {
         total += *process_progress;
         n++;
@@ -189,11 +441,256 @@ class ExecStreamingSubgraph : public ExecStep {
   }
 
  private:
+  /// state for running one process in threaded mode
+  struct Worker {
+    StreamingAtomicProcessPtr process;
+    /// runs process, recording profiling information
+    std::shared_ptr<ExecStreaming> step;
+
+    /// streaming input ports of process, and the corresponding staging
+    /// ports which upstream processes write to
+    std::vector<StreamPortBasePtr> in_ports;
+    std::vector<StreamPortBasePtr> staging_ports;
+
+    std::vector<StreamPortBasePtr> out_ports;
+    /// copies from out_ports to the staging ports of downstream workers
+    std::vector<ExecStepPtr> copies;
+    /// indices of downstream workers to wake after copying
+    std::vector<size_t> downstream;
+    /// downstream input ports, and the corresponding staging ports; the
+    /// total size of each pair is compared to the capacity of the input port
+    std::vector<std::pair<StreamPortBasePtr, StreamPortBasePtr>> downstream_ports;
+
+    /// has data been added to staging_ports since they were last moved
+    /// into in_ports; guarded by mutex
+    bool pending = false;
+    /// is the worker blocked in run_worker, and was it waiting for new input
+    /// (rather than just space in downstream ports); guarded by mutex
+    bool waiting = false;
+    bool wait_for_input = false;
+    /// has the worker returned from run_worker; guarded by mutex
+    bool finished = false;
+    /// last progress reported by process, or negative if not known
+    std::atomic<float> progress = -1.0f;
+  };
+
+  void setup_workers(const GraphIndex &index) {
+    std::map<ProcessPtr, size_t> worker_idx;
+    std::map<PortPtr, StreamPortBasePtr> staging_for_port;
+
+    for (auto &stage : stages) {
+      auto &process = stage.process->get_process();
+      auto worker = std::make_unique<Worker>();
+      worker->process = process;
+      worker->step = stage.process;
+
+      for (auto &[name, port] : process->get_in_port_map())
+        if (auto stream_port = std::dynamic_pointer_cast<StreamPortBase>(port)) {
+          auto staging_port = stream_port->make_similar(name);
+          worker->in_ports.push_back(stream_port);
+          worker->staging_ports.push_back(staging_port);
+          staging_for_port[stream_port] = staging_port;
+        }
+
+      worker_idx[process] = workers.size();
+      workers.push_back(std::move(worker));
+    }
+
+    for (auto &worker : workers) {
+      for (auto &[name, port] : worker->process->get_out_port_map())
+        if (auto stream_port = std::dynamic_pointer_cast<StreamPortBase>(port)) {
+          worker->out_ports.push_back(stream_port);
+
+          std::vector<StreamPortBasePtr> staging_ports;
+          for (auto &connected_port : index.connected_ports(stream_port)) {
+            auto staging_port = staging_for_port.at(connected_port);
+            staging_ports.push_back(staging_port);
+            worker->downstream_ports.emplace_back(checked_dynamic_pointer_cast<StreamPortBase>(connected_port),
+                                                  staging_port);
+          }
+          if (staging_ports.size())
+            worker->copies.push_back(std::make_shared<ExecCopyStream>(stream_port, std::move(staging_ports)));
+        }
+
+      for (auto &connection : index.output_connections(worker->process))
+        if (connection.is_streaming()) {
+          size_t idx = worker_idx.at(connection.downstream_process);
+          if (std::find(worker->downstream.begin(), worker->downstream.end(), idx) == worker->downstream.end())
+            worker->downstream.push_back(idx);
+        }
+    }
+  }
+
+  static size_t total_size(const std::vector<StreamPortBasePtr> &ports) {
+    size_t total = 0;
+    for (auto &port : ports) total += port->size();
+    return total;
+  }
+
+  static bool any_full(const std::vector<StreamPortBasePtr> &ports) {
+    return std::any_of(ports.begin(), ports.end(), [](auto &port) { return port->full(); });
+  }
+
+  /// are any of the downstream ports of worker full, counting items waiting
+  /// in the staging ports
+  ///
+  /// the input ports belong to other threads, but size() is safe to call
+  /// concurrently with push and pop; call with mutex held
+  static bool outputs_full(const Worker &worker) {
+    return std::any_of(worker.downstream_ports.begin(), worker.downstream_ports.end(), [](auto &ports) {
+      auto &[in_port, staging_port] = ports;
+      return in_port->size() + staging_port->size() >= in_port->capacity();
+    });
+  }
+
+  /// can worker run without ignoring back-pressure; call with mutex held
+  static bool can_continue(const Worker &worker) {
+    if (worker.wait_for_input && !worker.pending) return false;
+    return !outputs_full(worker);
+  }
+
+  /// are all workers other than worker waiting and unable to continue (or
+  /// finished)? in this case back-pressure is ignored to avoid deadlock; call
+  /// with mutex held
+  bool others_stalled(const Worker &worker) const {
+    return std::all_of(workers.begin(), workers.end(), [&](auto &other) {
+      return other.get() == &worker || other->finished || (other->waiting && !can_continue(*other));
+    });
+  }
+
+  static bool all_eof(const std::vector<StreamPortBasePtr> &ports) {
+    return std::all_of(ports.begin(), ports.end(), [](auto &port) { return port->eof(); });
+  }
+
+  static bool all_eof_triggered(const std::vector<StreamPortBasePtr> &ports) {
+    return std::all_of(ports.begin(), ports.end(), [](auto &port) { return port->eof_triggered(); });
+  }
+
+  /// body of the thread for one worker
+  ///
+  /// process() is always called once. after that, it is called while any of
+  /// the ports of this process are open, but if the last call did not
+  /// consume or produce anything, it waits for more input to arrive first
+  ///
+  /// before calling process(), this also waits while any of the downstream
+  /// ports are full, unless all other workers are stalled
+  void run_worker(Worker &worker) {
+    try {
+      bool first = true;
+      bool wait_for_input = false;
+      std::vector<bool> closed_sent(worker.out_ports.size(), false);
+
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          worker.wait_for_input = wait_for_input;
+          auto ready = [&]() {
+            if (can_continue(worker)) return true;
+            return !(worker.wait_for_input && !worker.pending) && others_stalled(worker);
+          };
+          if (!ready()) {
+            // others may be waiting for this worker to stall
+            worker.waiting = true;
+            wake_cv.notify_all();
+            wake_cv.wait(lock, [&]() { return error || ready(); });
+            worker.waiting = false;
+          }
+          if (error) return;
+
+          worker.pending = false;
+          for (size_t i = 0; i < worker.in_ports.size(); i++) {
+            worker.staging_ports[i]->move_to(*worker.in_ports[i]);
+            worker.staging_ports[i]->clear();
+          }
+        }
+
+        if (!first && all_eof(worker.in_ports) && all_eof(worker.out_ports)) break;
+        first = false;
+
+        size_t in_size_before = total_size(worker.in_ports);
+        worker.step->run();
+        worker.progress = worker.process->get_progress().value_or(-1.0f);
+
+        bool produced = false;
+        for (size_t i = 0; i < worker.out_ports.size(); i++) {
+          if (worker.out_ports[i]->size()) produced = true;
+          if (worker.out_ports[i]->eof_triggered() && !closed_sent[i]) {
+            produced = true;
+            closed_sent[i] = true;
+          }
+        }
+
+        // consuming may unblock upstream workers waiting for space
+        bool consumed = total_size(worker.in_ports) != in_size_before;
+        if (produced || consumed) {
+          std::unique_lock<std::mutex> lock(mutex);
+          if (produced) {
+            for (auto &copy : worker.copies) copy->run();
+            for (auto idx : worker.downstream) workers[idx]->pending = true;
+          }
+          wake_cv.notify_all();
+        }
+
+        // once all inputs are closed nothing else can arrive, so keep going
+        // without waiting, as in the single-threaded case
+        wait_for_input = !consumed && !produced && !all_eof_triggered(worker.in_ports);
+      }
+    } catch (...) {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (!error) error = std::current_exception();
+      wake_cv.notify_all();
+      finished_cv.notify_all();
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    n_finished++;
+    worker.finished = true;
+    wake_cv.notify_all();
+    finished_cv.notify_all();
+  }
+
   // all streaming ports in this subgraph for checking if we're done
   std::vector<StreamPortBasePtr> ports;
-  // for calling initialise/finalise
+  /// all ports before this index are at eof
+  size_t first_open_port = 0;
+  // for getting names and progress; in the same order as stages
   std::vector<StreamingAtomicProcessPtr> processes;
-  std::vector<ExecStepPtr> plan;
+
+  /// a process to run, and the copies to make after running it
+  struct Stage {
+    std::shared_ptr<ExecStreaming> process;
+    std::vector<ExecStepPtr> copies;
+    /// input ports connected to the outputs of process
+    std::vector<StreamPortBasePtr> downstream_ports;
+
+    /// streaming ports of process
+    std::vector<StreamPortBasePtr> in_ports;
+    std::vector<StreamPortBasePtr> out_ports;
+    /// indices of stages which read from out_ports
+    std::vector<size_t> downstream_stages;
+
+    /// should process be called on the next pass of run_run
+    bool ready = true;
+    /// has each of out_ports been closed, and this passed downstream
+    std::vector<bool> closed_sent;
+  };
+  std::vector<Stage> stages;
+  /// ignore full ports on the next call to run_run, because last time nothing
+  /// could make progress
+  bool ignore_full = false;
+
+  // threaded mode state; workers are in the same order as processes
+  bool threaded_;
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::mutex mutex;
+  /// notified when a worker may be able to continue: new input is
+  /// available, items have been consumed, or a worker started waiting or
+  /// finished
+  std::condition_variable wake_cv;
+  std::condition_variable finished_cv;
+  std::exception_ptr error;
+  size_t n_finished = 0;
 };
 
 }  // namespace eat::framework
@@ -1,4 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 
 #include "eat/framework/evaluate.hpp"
 #include "eat/framework/process.hpp"
@@ -193,3 +196,121 @@ TEST_CASE("functional branch") {
 
   REQUIRE(out->get_value() == "combine(a1(a(in)), a2(a(in)))");
 }
+
+TEST_CASE("functional run_parallel dependencies") {
+  Graph g;
+
+  auto in = g.add_process<DataSource<std::string>>("in", "in");
+
+  auto split = std::make_shared<FunctionalSplit>("split");
+  g.register_process(split);
+
+  auto a1 = std::make_shared<FunctionalInOut>("a1");
+  g.register_process(a1);
+  auto b1 = std::make_shared<FunctionalInOut>("b1");
+  g.register_process(b1);
+  auto a2 = std::make_shared<FunctionalInOut>("a2");
+  g.register_process(a2);
+
+  auto combine = std::make_shared<FunctionalCombine>("combine");
+  g.register_process(combine);
+
+  auto out = g.add_process<DataSink<std::string>>("out");
+
+  g.connect(in->get_out_port("out"), split->get_in_port("in"));
+  g.connect(split->get_out_port("out1"), a1->get_in_port("in"));
+  g.connect(a1->get_out_port("out"), b1->get_in_port("in"));
+  g.connect(split->get_out_port("out2"), a2->get_in_port("in"));
+  g.connect(b1->get_out_port("out"), combine->get_in_port("in1"));
+  g.connect(a2->get_out_port("out"), combine->get_in_port("in2"));
+  g.connect(combine->get_out_port("out"), out->get_in_port("in"));
+
+  Plan p = plan(g);
+
+  // each step only depends on earlier steps, and the data copy out of each
+  // process depends on that process
+  auto &dependencies = p.dependencies();
+  REQUIRE(dependencies.size() == p.steps().size());
+  for (size_t i = 0; i < dependencies.size(); i++)
+    for (size_t dependency : dependencies[i]) REQUIRE(dependency < i);
+
+  p.run_parallel(4);
+
+  REQUIRE(out->get_value() == "combine(b1(a1(split.out1(in))), a2(split.out2(in)))");
+}
+
+/// rendezvous between a number of processes, to check that they are ran at the
+/// same time
+struct Rendezvous {
+  explicit Rendezvous(size_t n_) : n(n_) {}
+
+  /// wait for n processes to arrive; returns false on timeout
+  bool arrive() {
+    std::unique_lock<std::mutex> lock(mutex);
+    n_arrived++;
+    cv.notify_all();
+    return cv.wait_for(lock, std::chrono::seconds(10), [&]() { return n_arrived >= n; });
+  }
+
+  size_t n;
+  size_t n_arrived = 0;
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+/// process which waits at a rendezvous, and outputs whether the others arrived
+class FunctionalRendezvous : public FunctionalAtomicProcess {
+ public:
+  FunctionalRendezvous(const std::string &name, std::shared_ptr<Rendezvous> rendezvous_)
+      : FunctionalAtomicProcess(name), out(add_out_port<DataPort<bool>>("out")), rendezvous(std::move(rendezvous_)) {}
+
+  virtual void process() override { out->set_value(rendezvous->arrive()); }
+
+ private:
+  DataPortPtr<bool> out;
+  std::shared_ptr<Rendezvous> rendezvous;
+};
+
+TEST_CASE("functional run_parallel concurrent") {
+  Graph g;
+
+  auto rendezvous = std::make_shared<Rendezvous>(3);
+
+  std::vector<std::shared_ptr<DataSink<bool>>> outs;
+  for (size_t i = 0; i < 3; i++) {
+    auto p = g.add_process<FunctionalRendezvous>("p" + std::to_string(i), rendezvous);
+    auto out = g.add_process<DataSink<bool>>("out" + std::to_string(i));
+    g.connect(p->get_out_port("out"), out->get_in_port("in"));
+    outs.push_back(out);
+  }
+
+  plan(g).run_parallel(3);
+
+  for (auto &out : outs) REQUIRE(out->get_value());
+}
+
+/// process which always throws
+class FunctionalThrow : public FunctionalAtomicProcess {
+ public:
+  FunctionalThrow(const std::string &name)
+      : FunctionalAtomicProcess(name), out(add_out_port<DataPort<std::string>>("out")) {}
+
+  virtual void process() override { throw std::runtime_error("failed"); }
+
+ private:
+  DataPortPtr<std::string> out;
+};
+
+TEST_CASE("functional run_parallel exception") {
+  Graph g;
+
+  auto t = g.add_process<FunctionalThrow>("t");
+  auto a = g.add_process<FunctionalInOut>("a");
+  auto out = g.add_process<DataSink<std::string>>("out");
+
+  g.connect(t->get_out_port("out"), a->get_in_port("in"));
+  g.connect(a->get_out_port("out"), out->get_in_port("in"));
+
+  REQUIRE_THROWS_AS(plan(g).run_parallel(2), std::runtime_error);
+  REQUIRE_THROWS(out->get_value());
+}
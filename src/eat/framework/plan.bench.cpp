@@ -0,0 +1,82 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "eat/framework/evaluate.hpp"
+#include "eat/framework/process.hpp"
+#include "eat/framework/utility_processes.hpp"
+
+using namespace eat::framework;
+
+namespace {
+
+class Source : public StreamingAtomicProcess {
+ public:
+  Source(const std::string &name) : StreamingAtomicProcess(name), out(add_out_port<StreamPort<int>>("out")) {}
+
+  void process() override { out->close(); }
+
+ private:
+  StreamPortPtr<int> out;
+};
+
+class PassThrough : public StreamingAtomicProcess {
+ public:
+  PassThrough(const std::string &name)
+      : StreamingAtomicProcess(name),
+        in(add_in_port<StreamPort<int>>("in")),
+        out(add_out_port<StreamPort<int>>("out")) {}
+
+  void process() override {
+    while (in->available()) out->push(in->pop());
+    if (in->eof()) out->close();
+  }
+
+ private:
+  StreamPortPtr<int> in;
+  StreamPortPtr<int> out;
+};
+
+class Count : public StreamingAtomicProcess {
+ public:
+  Count(const std::string &name)
+      : StreamingAtomicProcess(name), in(add_in_port<StreamPort<int>>("in")), out(add_out_port<DataPort<int>>("out")) {}
+
+  void process() override {
+    while (in->available()) {
+      in->pop();
+      count++;
+    }
+  }
+
+  void finalise() override { out->set_value(count); }
+
+ private:
+  StreamPortPtr<int> in;
+  DataPortPtr<int> out;
+  int count = 0;
+};
+
+}  // namespace
+
+TEST_CASE("bench plan large graph") {
+  // one source feeding many chains of streaming processes, each ending in a
+  // non-streaming sink, like graphs which process each object separately
+  const size_t n_chains = GENERATE(100, 2500);
+
+  Graph g;
+  auto source = g.add_process<Source>("source");
+  for (size_t i = 0; i < n_chains; i++) {
+    auto a = g.add_process<PassThrough>("a");
+    auto b = g.add_process<PassThrough>("b");
+    auto count = g.add_process<Count>("count");
+    auto sink = g.add_process<NullSink<int>>("sink");
+
+    g.connect(source->get_out_port("out"), a->get_in_port("in"));
+    g.connect(a->get_out_port("out"), b->get_in_port("in"));
+    g.connect(b->get_out_port("out"), count->get_in_port("in"));
+    g.connect(count->get_out_port("out"), sink->get_in_port("in"));
+  }
+
+  BENCHMARK("plan " + std::to_string(g.get_processes().size()) + " processes") { return plan(g); };
+}
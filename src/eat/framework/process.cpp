@@ -14,14 +14,23 @@ static void check_connection(const PortPtr &a, const PortPtr &b) {
 
 ProcessPtr Graph::register_process(ProcessPtr process) {
   processes.push_back(process);
+  for (auto &pair : process->get_in_port_map()) port_is_input[pair.second.get()] = true;
+  for (auto &pair : process->get_out_port_map()) port_is_input[pair.second.get()] = false;
   return process;
 }
 
-void Graph::connect(const PortPtr &a, const PortPtr &b) {
-  check_connection(a, b);
+void Graph::find_sub_process_ports(const PortPtr &a, const PortPtr &b, bool &found_a, bool &found_b) const {
+  auto it_a = port_is_input.find(a.get());
+  auto it_b = port_is_input.find(b.get());
+
+  // if both are known, no need to search
+  if (it_a != port_is_input.end() && it_b != port_is_input.end()) {
+    if (it_a->second) throw std::runtime_error("cannot connect from an input port of a sub-process");
+    if (!it_b->second) throw std::runtime_error("cannot connect to an output port of a sub-process");
+    found_a = found_b = true;
+    return;
+  }
 
-  bool found_a = false;
-  bool found_b = false;
   for (auto &process : get_processes()) {
     for (auto &pair : process->get_in_port_map()) {
       if (pair.second == b) found_b = true;
@@ -33,6 +42,14 @@ void Graph::connect(const PortPtr &a, const PortPtr &b) {
       if (pair.second == b) throw std::runtime_error("cannot connect to an output port of a sub-process");
     }
   }
+}
+
+void Graph::connect(const PortPtr &a, const PortPtr &b) {
+  check_connection(a, b);
+
+  bool found_a = false;
+  bool found_b = false;
+  find_sub_process_ports(a, b, found_a, found_b);
 
   if (!found_a) throw std::runtime_error("cannot connect from an unregistered port");
   if (!found_b) throw std::runtime_error("cannot connect to an unregistered port");
@@ -56,17 +73,7 @@ void CompositeProcess::connect(const PortPtr &a, const PortPtr &b) {
     if (pair.second == a) throw std::runtime_error("cannot connect from an output port of the current process");
   }
 
-  for (auto &process : get_processes()) {
-    for (auto &pair : process->get_in_port_map()) {
-      if (pair.second == b) found_b = true;
-      if (pair.second == a) throw std::runtime_error("cannot connect from an input port of a sub-process");
-    }
-
-    for (auto &pair : process->get_out_port_map()) {
-      if (pair.second == a) found_a = true;
-      if (pair.second == b) throw std::runtime_error("cannot connect to an output port of a sub-process");
-    }
-  }
+  find_sub_process_ports(a, b, found_a, found_b);
 
   if (!found_a) throw std::runtime_error("cannot connect from an unregistered port");
   if (!found_b) throw std::runtime_error("cannot connect to an unregistered port");
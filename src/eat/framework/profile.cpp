@@ -0,0 +1,39 @@
+#include "eat/framework/profile.hpp"
+
+#ifdef WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace eat::framework {
+
+ProcessProfile &Profiler::add_process(std::string name) {
+  auto &profile = processes_.emplace_back();
+  profile.name = std::move(name);
+  return profile;
+}
+
+StepProfile &Profiler::add_step(std::string description) {
+  auto &profile = steps_.emplace_back();
+  profile.description = std::move(description);
+  return profile;
+}
+
+double thread_cpu_time() {
+#ifdef WIN32
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time)) return 0.0;
+  auto to_100ns = [](const FILETIME &t) {
+    return (static_cast<unsigned long long>(t.dwHighDateTime) << 32) | t.dwLowDateTime;
+  };
+  return static_cast<double>(to_100ns(kernel_time) + to_100ns(user_time)) * 1e-7;
+#else
+  timespec t;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t) != 0) return 0.0;
+  return static_cast<double>(t.tv_sec) + static_cast<double>(t.tv_nsec) * 1e-9;
+#endif
+}
+
+}  // namespace eat::framework
@@ -0,0 +1,72 @@
+#include "eat/framework/ring_buffer.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <memory>
+#include <thread>
+
+using namespace eat::framework;
+
+TEST_CASE("ring buffer push pop") {
+  RingBuffer<std::unique_ptr<int>> buf(3);
+  REQUIRE(buf.storage_size() == 4);
+  REQUIRE(buf.empty());
+
+  // go round a few times to check wrapping
+  int next_push = 0, next_pop = 0;
+  for (int i = 0; i < 10; i++) {
+    for (int j = 0; j < 3; j++) REQUIRE(buf.try_push(std::make_unique<int>(next_push++)));
+    REQUIRE(buf.size() == 3);
+    for (int j = 0; j < 3; j++) REQUIRE(*buf.pop() == next_pop++);
+    REQUIRE(buf.empty());
+  }
+
+  REQUIRE_THROWS(buf.pop());
+}
+
+TEST_CASE("ring buffer full") {
+  RingBuffer<std::unique_ptr<int>> buf(2);
+
+  REQUIRE(buf.try_push(std::make_unique<int>(0)));
+  REQUIRE(buf.try_push(std::make_unique<int>(1)));
+
+  // failed try_push must leave the value alone
+  auto value = std::make_unique<int>(2);
+  REQUIRE(!buf.try_push(std::move(value)));
+  REQUIRE(value);
+
+  // push grows the storage, keeping the order
+  buf.pop();
+  buf.push(std::move(value));
+  buf.push(std::make_unique<int>(3));
+  REQUIRE(buf.storage_size() == 4);
+  REQUIRE(buf.size() == 3);
+  REQUIRE(*buf[0] == 1);
+  REQUIRE(*buf[2] == 3);
+  for (int i = 1; i < 4; i++) REQUIRE(*buf.pop() == i);
+
+  buf.push(std::make_unique<int>(4));
+  buf.clear();
+  REQUIRE(buf.empty());
+  REQUIRE(buf.storage_size() == 4);
+}
+
+TEST_CASE("ring buffer threaded") {
+  // one thread pushing and one popping, without locks
+  RingBuffer<int> buf(16);
+  const int n = 100000;
+
+  std::thread producer([&]() {
+    for (int i = 0; i < n; i++)
+      while (!buf.try_push(int{i})) std::this_thread::yield();
+  });
+
+  bool in_order = true;
+  for (int i = 0; i < n; i++) {
+    while (buf.empty()) std::this_thread::yield();
+    if (buf.pop() != i) in_order = false;
+  }
+  producer.join();
+
+  REQUIRE(in_order);
+  REQUIRE(buf.empty());
+}
@@ -1,4 +1,6 @@
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <map>
 
 #include "eat/framework/evaluate.hpp"
 #include "eat/framework/process.hpp"
@@ -80,7 +82,9 @@ TEST_CASE("streaming split simple") {
   g.connect(in->get_out_port("out_stream"), out_stream->get_in_port("in"));
   g.connect(in->get_out_port("out_data"), out_data->get_in_port("in"));
 
-  evaluate(g);
+  PlanOptions options;
+  options.threaded_streaming = GENERATE(false, true);
+  evaluate(g, options);
 
   REQUIRE(out_data->get_value() == "in.data(out.data)");
   REQUIRE(out_stream->get_value() == "in.stream(out.stream0, out.stream1)");
@@ -124,7 +128,9 @@ TEST_CASE("streaming split cross") {
   g.connect(in1->get_out_port("out_data"), in1_out_data->get_in_port("in"));
   g.connect(in2->get_out_port("out_data"), in2_out_data->get_in_port("in"));
 
-  evaluate(g);
+  PlanOptions options;
+  options.threaded_streaming = GENERATE(false, true);
+  evaluate(g, options);
 
   REQUIRE(in1_out_data->get_value() == "in1.data(out2.data)");
   REQUIRE(in2_out_data->get_value() == "in2.data(out1.data)");
@@ -167,7 +173,9 @@ TEST_CASE("streaming fork") {
   g.connect(in2->get_out_port("out_data"), in2_out_data->get_in_port("in"));
   g.connect(out->get_out_port("out_data"), out_out_data->get_in_port("in"));
 
-  evaluate(g);
+  PlanOptions options;
+  options.threaded_streaming = GENERATE(false, true);
+  evaluate(g, options);
 
   REQUIRE(in1_out_stream->get_value() == "in1.stream(out.stream0, out.stream1)");
   REQUIRE(in2_out_stream->get_value() == "in2.stream(out.stream0, out.stream1)");
@@ -234,8 +242,807 @@ TEST_CASE("streaming split dup") {
   g.connect(in->get_out_port("out_data"), in_data->get_in_port("in"));
   g.connect(in->get_out_port("out_stream"), in_stream->get_in_port("in"));
 
-  evaluate(g);
+  PlanOptions options;
+  options.threaded_streaming = GENERATE(false, true);
+  evaluate(g, options);
 
   REQUIRE(in_data->get_value() == "in.data(out.data)");
   REQUIRE(in_stream->get_value() == "in(stream1(out.stream0, out.stream1), stream2(out.stream0, out.stream1))");
 }
+
+/// sends n_messages messages; can be duplicated
+class DuplicableSource : public StreamingAtomicProcess {
+ public:
+  DuplicableSource(const std::string &name, int n_messages_)
+      : StreamingAtomicProcess(name), out(add_out_port<StreamPort<std::string>>("out")), n_messages(n_messages_) {}
+
+  void process() override {
+    if (message_idx < n_messages)
+      out->push("m" + std::to_string(message_idx++));
+    else
+      out->close();
+  }
+
+  bool is_duplicable() const override { return true; }
+
+  StreamingAtomicProcessPtr duplicate(const std::string &name) const override {
+    return std::make_shared<DuplicableSource>(name, n_messages);
+  }
+
+ private:
+  StreamPortPtr<std::string> out;
+  int n_messages;
+  int message_idx = 0;
+};
+
+/// adds a prefix from a data port to each message; can be duplicated
+class DuplicablePrefix : public StreamingAtomicProcess {
+ public:
+  DuplicablePrefix(const std::string &name)
+      : StreamingAtomicProcess(name),
+        in_prefix(add_in_port<DataPort<std::string>>("in_prefix")),
+        in(add_in_port<StreamPort<std::string>>("in")),
+        out(add_out_port<StreamPort<std::string>>("out")) {}
+
+  void process() override {
+    while (in->available()) out->push(in_prefix->get_value() + in->pop());
+    if (in->eof()) out->close();
+  }
+
+  bool is_duplicable() const override { return true; }
+
+  StreamingAtomicProcessPtr duplicate(const std::string &name) const override {
+    return std::make_shared<DuplicablePrefix>(name);
+  }
+
+ private:
+  DataPortPtr<std::string> in_prefix;
+  StreamPortPtr<std::string> in;
+  StreamPortPtr<std::string> out;
+};
+
+/// stream item type which can be converted to a string, for testing
+/// ConvertStream
+struct Number {
+  int value;
+};
+
+/// converts a stream of Number to a stream of strings
+class NumberToString : public StreamingAtomicProcess {
+ public:
+  NumberToString(const std::string &name)
+      : StreamingAtomicProcess(name),
+        in(add_in_port<StreamPort<Number>>("in")),
+        out(add_out_port<StreamPort<std::string>>("out")) {}
+
+  void process() override {
+    while (in->available()) out->push(std::to_string(in->pop().value));
+    if (in->eof()) out->close();
+  }
+
+  bool is_duplicable() const override { return true; }
+
+  StreamingAtomicProcessPtr duplicate(const std::string &name) const override {
+    return std::make_shared<NumberToString>(name);
+  }
+
+ private:
+  StreamPortPtr<Number> in;
+  StreamPortPtr<std::string> out;
+};
+
+namespace eat::framework {
+template <>
+struct ConvertStream<Number> {
+  static bool can_convert(const StreamPortBase &to) { return dynamic_cast<const StreamPort<std::string> *>(&to); }
+  static ProcessPtr get_converter(const std::string &name, const StreamPortBase &to) {
+    if (!can_convert(to)) return nullptr;
+    return std::make_shared<NumberToString>(name);
+  }
+};
+}  // namespace eat::framework
+
+/// pushes n_messages Numbers; can be duplicated
+class DuplicableNumberSource : public StreamingAtomicProcess {
+ public:
+  DuplicableNumberSource(const std::string &name, int n_messages_)
+      : StreamingAtomicProcess(name), out(add_out_port<StreamPort<Number>>("out")), n_messages(n_messages_) {}
+
+  void process() override {
+    if (message_idx < n_messages)
+      out->push(Number{message_idx++});
+    else
+      out->close();
+  }
+
+  bool is_duplicable() const override { return true; }
+
+  StreamingAtomicProcessPtr duplicate(const std::string &name) const override {
+    return std::make_shared<DuplicableNumberSource>(name, n_messages);
+  }
+
+ private:
+  StreamPortPtr<Number> out;
+  int n_messages;
+  int message_idx = 0;
+};
+
+TEST_CASE("streaming split duplicates processes") {
+  Graph g;
+
+  // source -> prefix streams into first and second, but second also needs
+  // data from first, so the connection to second must be broken; this should
+  // be done by running copies of source and prefix rather than buffering
+
+  // if the source produces Numbers, they are converted to strings before
+  // prefix, and the converter must be duplicated too
+  const bool through_conversion = GENERATE(false, true);
+  ProcessPtr source;
+  if (through_conversion)
+    source = g.add_process<DuplicableNumberSource>("source", 2);
+  else
+    source = g.add_process<DuplicableSource>("source", 2);
+  auto prefix_data = g.add_process<DataSource<std::string>>("prefix_data", "p.");
+  auto prefix = g.add_process<DuplicablePrefix>("prefix");
+  auto first = g.add_process<StreamAndDataIn>("first");
+  auto second = g.add_process<StreamAndDataIn>("second");
+  auto first_data = g.add_process<NullSink<std::string>>("first_data");
+  auto second_data = g.add_process<NullSink<std::string>>("second_data");
+  auto first_stream = g.add_process<DataSink<std::string>>("first_stream");
+  auto second_stream = g.add_process<DataSink<std::string>>("second_stream");
+
+  g.connect(source->get_out_port("out"), prefix->get_in_port("in"));
+  g.connect(prefix_data->get_out_port("out"), prefix->get_in_port("in_prefix"));
+  g.connect(prefix->get_out_port("out"), first->get_in_port("in_stream"));
+  g.connect(prefix->get_out_port("out"), second->get_in_port("in_stream"));
+  g.connect(first->get_out_port("out_stream"), second->get_in_port("in_data"));
+
+  auto null_data = g.add_process<DataSource<std::string>>("null_data", "");
+  g.connect(null_data->get_out_port("out"), first->get_in_port("in_data"));
+  g.connect(first->get_out_port("out_data"), first_data->get_in_port("in"));
+  g.connect(second->get_out_port("out_data"), second_data->get_in_port("in"));
+  g.connect(first->get_out_port("out_stream"), first_stream->get_in_port("in"));
+  g.connect(second->get_out_port("out_stream"), second_stream->get_in_port("in"));
+
+  PlanOptions options;
+  options.threaded_streaming = GENERATE(false, true);
+  Plan p = plan(g, options);
+
+  size_t n_duplicates = 0;
+  for (auto &process : p.graph().get_processes()) {
+    REQUIRE(process->name() != "buffer writer");
+    if (process->name().find("(duplicate)") != std::string::npos) n_duplicates++;
+  }
+  REQUIRE(n_duplicates == (through_conversion ? 3 : 2));
+
+  p.run();
+
+  if (through_conversion) {
+    REQUIRE(first_stream->get_value() == "first.stream(p.0, p.1)");
+    REQUIRE(second_stream->get_value() == "second.stream(p.0, p.1)");
+  } else {
+    REQUIRE(first_stream->get_value() == "first.stream(p.m0, p.m1)");
+    REQUIRE(second_stream->get_value() == "second.stream(p.m0, p.m1)");
+  }
+}
+
+/// the messages sent by PassthroughMessageSource
+struct MessageCount : public PassthroughSource {
+  explicit MessageCount(int n_messages_) : n_messages(n_messages_) {}
+  int n_messages;
+};
+
+/// sends n_messages messages, which can be passed through to CountMessages
+class PassthroughMessageSource : public StreamingAtomicProcess {
+ public:
+  PassthroughMessageSource(const std::string &name, int n_messages_)
+      : StreamingAtomicProcess(name), out(add_out_port<StreamPort<std::string>>("out")), n_messages(n_messages_) {}
+
+  void process() override {
+    if (message_idx < n_messages)
+      out->push("m" + std::to_string(message_idx++));
+    else
+      out->close();
+  }
+
+  PassthroughSourcePtr passthrough_source(const std::string &) const override {
+    return std::make_shared<MessageCount>(n_messages);
+  }
+
+ private:
+  StreamPortPtr<std::string> out;
+  int n_messages;
+  int message_idx = 0;
+};
+
+/// counts the input messages; if the input is a PassthroughMessageSource, this
+/// is replaced by a DataSource with the number of messages
+class CountMessages : public StreamingAtomicProcess {
+ public:
+  CountMessages(const std::string &name)
+      : StreamingAtomicProcess(name),
+        in(add_in_port<StreamPort<std::string>>("in")),
+        out(add_out_port<DataPort<int>>("out")) {}
+
+  void process() override {
+    while (in->available()) {
+      in->pop();
+      count++;
+    }
+  }
+
+  void finalise() override { out->set_value(count); }
+
+  ProcessPtr passthrough(const std::string &name, const std::string &, const PassthroughSource &source) const override {
+    auto message_count = dynamic_cast<const MessageCount *>(&source);
+    if (!message_count) return nullptr;
+    return std::make_shared<DataSource<int>>(name, message_count->n_messages);
+  }
+
+ private:
+  StreamPortPtr<std::string> in;
+  DataPortPtr<int> out;
+  int count = 0;
+};
+
+TEST_CASE("streaming passthrough") {
+  Graph g;
+
+  auto source = g.add_process<PassthroughMessageSource>("source", 3);
+  auto count = g.add_process<CountMessages>("count");
+  auto result = g.add_process<DataSink<int>>("result");
+
+  g.connect(source->get_out_port("out"), count->get_in_port("in"));
+  g.connect(count->get_out_port("out"), result->get_in_port("in"));
+
+  // if the source is used elsewhere it must still run, so no passthrough
+  // should happen
+  const bool shared_source = GENERATE(false, true);
+  std::shared_ptr<CountMessages> other_count;
+  std::shared_ptr<DataSink<int>> other_result;
+  if (shared_source) {
+    other_count = g.add_process<CountMessages>("other count");
+    other_result = g.add_process<DataSink<int>>("other result");
+    g.connect(source->get_out_port("out"), other_count->get_in_port("in"));
+    g.connect(other_count->get_out_port("out"), other_result->get_in_port("in"));
+  }
+
+  Plan p = plan(g);
+
+  bool found_source = false, found_count = false;
+  for (auto &process : p.graph().get_processes()) {
+    if (process == source) found_source = true;
+    if (process == count) found_count = true;
+  }
+  REQUIRE(found_source == shared_source);
+  REQUIRE(found_count == shared_source);
+
+  p.run();
+
+  REQUIRE(result->get_value() == 3);
+  if (shared_source) REQUIRE(other_result->get_value() == 3);
+}
+
+/// source which pushes n_blocks blocks of block_size deterministic values
+class SequenceSource : public StreamingAtomicProcess {
+ public:
+  SequenceSource(const std::string &name, size_t n_blocks_, size_t block_size_)
+      : StreamingAtomicProcess(name),
+        out(add_out_port<StreamPort<std::vector<float>>>("out")),
+        n_blocks(n_blocks_),
+        block_size(block_size_) {}
+
+  void process() override {
+    if (block_idx < n_blocks) {
+      std::vector<float> block(block_size);
+      for (auto &sample : block) {
+        state = state * 1103515245u + 12345u;
+        sample = static_cast<float>(state >> 8) / static_cast<float>(1u << 24) - 0.5f;
+      }
+      out->push(std::move(block));
+      block_idx++;
+    } else
+      out->close();
+  }
+
+ private:
+  StreamPortPtr<std::vector<float>> out;
+  size_t n_blocks;
+  size_t block_size;
+  size_t block_idx = 0;
+  uint32_t state = 1;
+};
+
+/// one-pole filter, processing all available blocks
+class Filter : public StreamingAtomicProcess {
+ public:
+  Filter(const std::string &name, float coeff_)
+      : StreamingAtomicProcess(name),
+        in(add_in_port<StreamPort<std::vector<float>>>("in")),
+        out(add_out_port<StreamPort<std::vector<float>>>("out")),
+        coeff(coeff_) {}
+
+  void process() override {
+    while (in->available()) {
+      auto block = in->pop();
+      for (auto &sample : block) sample = last = sample + coeff * last;
+      out->push(std::move(block));
+    }
+    if (in->eof()) out->close();
+  }
+
+ private:
+  StreamPortPtr<std::vector<float>> in;
+  StreamPortPtr<std::vector<float>> out;
+  float coeff;
+  float last = 0.0f;
+};
+
+/// sum of two streams, processing one block from each at a time
+class Mix : public StreamingAtomicProcess {
+ public:
+  Mix(const std::string &name)
+      : StreamingAtomicProcess(name),
+        in1(add_in_port<StreamPort<std::vector<float>>>("in1")),
+        in2(add_in_port<StreamPort<std::vector<float>>>("in2")),
+        out(add_out_port<StreamPort<std::vector<float>>>("out")) {}
+
+  void process() override {
+    if (in1->available() && in2->available()) {
+      auto block = in1->pop();
+      auto block2 = in2->pop();
+      for (size_t i = 0; i < block.size(); i++) block[i] = block[i] * 0.75f + block2[i] * 0.25f;
+      out->push(std::move(block));
+    }
+    if (in1->eof() && in2->eof()) out->close();
+  }
+
+ private:
+  StreamPortPtr<std::vector<float>> in1;
+  StreamPortPtr<std::vector<float>> in2;
+  StreamPortPtr<std::vector<float>> out;
+};
+
+/// concatenate all blocks into a data output
+class Collect : public StreamingAtomicProcess {
+ public:
+  Collect(const std::string &name)
+      : StreamingAtomicProcess(name),
+        in(add_in_port<StreamPort<std::vector<float>>>("in")),
+        out(add_out_port<DataPort<std::vector<float>>>("out")) {}
+
+  void process() override {
+    while (in->available()) {
+      auto block = in->pop();
+      samples.insert(samples.end(), block.begin(), block.end());
+    }
+  }
+
+  void finalise() override { out->set_value(std::move(samples)); }
+
+ private:
+  StreamPortPtr<std::vector<float>> in;
+  DataPortPtr<std::vector<float>> out;
+  std::vector<float> samples;
+};
+
+/// source -> filter a -> mix -> collect
+///        -> filter b ----^
+///        -> collect
+static std::pair<std::vector<float>, std::vector<float>> run_filter_graph(const PlanOptions &options) {
+  Graph g;
+  auto source = g.add_process<SequenceSource>("source", 200, 64);
+  auto filter_a = g.add_process<Filter>("filter_a", 0.5f);
+  auto filter_b = g.add_process<Filter>("filter_b", -0.25f);
+  auto mix = g.add_process<Mix>("mix");
+  auto collect_mix = g.add_process<Collect>("collect_mix");
+  auto collect_source = g.add_process<Collect>("collect_source");
+  auto sink_mix = g.add_process<DataSink<std::vector<float>>>("sink_mix");
+  auto sink_source = g.add_process<DataSink<std::vector<float>>>("sink_source");
+
+  g.connect(source->get_out_port("out"), filter_a->get_in_port("in"));
+  g.connect(source->get_out_port("out"), filter_b->get_in_port("in"));
+  g.connect(source->get_out_port("out"), collect_source->get_in_port("in"));
+  g.connect(filter_a->get_out_port("out"), mix->get_in_port("in1"));
+  g.connect(filter_b->get_out_port("out"), mix->get_in_port("in2"));
+  g.connect(mix->get_out_port("out"), collect_mix->get_in_port("in"));
+  g.connect(collect_mix->get_out_port("out"), sink_mix->get_in_port("in"));
+  g.connect(collect_source->get_out_port("out"), sink_source->get_in_port("in"));
+
+  evaluate(g, options);
+
+  return {sink_mix->get_value(), sink_source->get_value()};
+}
+
+TEST_CASE("streaming threaded matches serial") {
+  PlanOptions serial_options;
+  auto [serial_mix, serial_source] = run_filter_graph(serial_options);
+  REQUIRE(serial_mix.size() == 200 * 64);
+  REQUIRE(serial_source.size() == 200 * 64);
+
+  PlanOptions threaded_options;
+  threaded_options.threaded_streaming = true;
+  for (int i = 0; i < 10; i++) {
+    auto [threaded_mix, threaded_source] = run_filter_graph(threaded_options);
+    // exact comparison: the results should be bit-identical
+    REQUIRE(threaded_mix == serial_mix);
+    REQUIRE(threaded_source == serial_source);
+  }
+}
+
+TEST_CASE("streaming profile") {
+  PlanOptions options;
+  options.threaded_streaming = GENERATE(false, true);
+  options.profiler = std::make_shared<Profiler>();
+  run_filter_graph(options);
+
+  std::map<std::string, const ProcessProfile *> processes;
+  for (auto &process : options.profiler->processes()) processes[process.name] = &process;
+  REQUIRE(processes.size() == 8);
+
+  for (auto &[name, process] : processes) {
+    if (name.rfind("sink", 0) == 0) {
+      REQUIRE(process->process.calls == 1);
+    } else {
+      REQUIRE(process->initialise.calls == 1);
+      REQUIRE(process->process.calls >= 1);
+      REQUIRE(process->finalise.calls == 1);
+    }
+    REQUIRE(process->process.wall_time >= 0.0);
+    REQUIRE(process->process.cpu_time >= 0.0);
+  }
+
+  REQUIRE(processes.at("source")->process.calls >= 201);
+  REQUIRE(processes.at("source")->out_ports.at("out").items == 200);
+  REQUIRE(processes.at("source")->out_ports.at("out").max_queued >= 1);
+  REQUIRE(processes.at("filter_a")->in_ports.at("in").items == 200);
+  REQUIRE(processes.at("filter_a")->in_ports.at("in").max_queued >= 1);
+  REQUIRE(processes.at("mix")->in_ports.at("in1").items == 200);
+  REQUIRE(processes.at("mix")->in_ports.at("in2").items == 200);
+  REQUIRE(processes.at("mix")->out_ports.at("out").items == 200);
+  REQUIRE(processes.at("collect_source")->in_ports.at("in").items == 200);
+  // data ports are not profiled
+  REQUIRE(processes.at("collect_mix")->out_ports.empty());
+
+  REQUIRE(options.profiler->steps().size() >= 3);
+  for (auto &step : options.profiler->steps()) REQUIRE(step.run.calls == 1);
+}
+
+/// passes blocks through, throwing after n blocks
+class ThrowAfter : public StreamingAtomicProcess {
+ public:
+  ThrowAfter(const std::string &name, size_t n_)
+      : StreamingAtomicProcess(name),
+        in(add_in_port<StreamPort<std::vector<float>>>("in")),
+        out(add_out_port<StreamPort<std::vector<float>>>("out")),
+        n(n_) {}
+
+  void process() override {
+    while (in->available()) {
+      if (n == 0) throw std::runtime_error("failed in process");
+      out->push(in->pop());
+      n--;
+    }
+    if (in->eof()) out->close();
+  }
+
+ private:
+  StreamPortPtr<std::vector<float>> in;
+  StreamPortPtr<std::vector<float>> out;
+  size_t n;
+};
+
+TEST_CASE("streaming threaded exception") {
+  Graph g;
+  auto source = g.add_process<SequenceSource>("source", 100, 16);
+  auto thrower = g.add_process<ThrowAfter>("thrower", 10);
+  auto collect = g.add_process<Collect>("collect");
+  auto sink = g.add_process<NullSink<std::vector<float>>>("sink");
+
+  g.connect(source->get_out_port("out"), thrower->get_in_port("in"));
+  g.connect(thrower->get_out_port("out"), collect->get_in_port("in"));
+  g.connect(collect->get_out_port("out"), sink->get_in_port("in"));
+
+  PlanOptions options;
+  options.threaded_streaming = true;
+  REQUIRE_THROWS_AS(evaluate(g, options), std::runtime_error);
+}
+
+/// pushes n_items ints, burst_size per call
+class BurstSource : public StreamingAtomicProcess {
+ public:
+  BurstSource(const std::string &name, int n_items_, int burst_size_)
+      : StreamingAtomicProcess(name),
+        out(add_out_port<StreamPort<int>>("out")),
+        n_items(n_items_),
+        burst_size(burst_size_) {}
+
+  void process() override {
+    for (int i = 0; i < burst_size && next < n_items; i++) out->push(next++);
+    if (next == n_items) out->close();
+  }
+
+ private:
+  StreamPortPtr<int> out;
+  int n_items;
+  int burst_size;
+  int next = 0;
+};
+
+/// reads one item per call, recording the largest number of items waiting
+class SlowSink : public StreamingAtomicProcess {
+ public:
+  SlowSink(const std::string &name)
+      : StreamingAtomicProcess(name),
+        in(add_in_port<StreamPort<int>>("in")),
+        out(add_out_port<DataPort<std::vector<int>>>("out")) {}
+
+  void process() override {
+    max_waiting = std::max(max_waiting, in->size());
+    if (in->available()) items.push_back(in->pop());
+  }
+
+  void finalise() override { out->set_value(std::move(items)); }
+
+  StreamPortPtr<int> in;
+  DataPortPtr<std::vector<int>> out;
+  std::vector<int> items;
+  size_t max_waiting = 0;
+};
+
+TEST_CASE("streaming back-pressure") {
+  Graph g;
+  auto source = g.add_process<BurstSource>("source", 400, 4);
+  auto sink = g.add_process<SlowSink>("sink");
+  auto out = g.add_process<DataSink<std::vector<int>>>("out");
+  sink->in->set_capacity(8);
+
+  g.connect(source->get_out_port("out"), sink->get_in_port("in"));
+  g.connect(sink->get_out_port("out"), out->get_in_port("in"));
+
+  PlanOptions options;
+  options.threaded_streaming = GENERATE(false, true);
+  evaluate(g, options);
+
+  std::vector<int> expected(400);
+  for (int i = 0; i < 400; i++) expected[i] = i;
+  REQUIRE(out->get_value() == expected);
+
+  // the source only runs when there are fewer than 8 items waiting
+  REQUIRE(sink->max_waiting <= 8 + 4);
+}
+
+/// holds all blocks until the input is closed
+class Hold : public StreamingAtomicProcess {
+ public:
+  Hold(const std::string &name)
+      : StreamingAtomicProcess(name),
+        in(add_in_port<StreamPort<std::vector<float>>>("in")),
+        out(add_out_port<StreamPort<std::vector<float>>>("out")) {}
+
+  void process() override {
+    while (in->available()) held.push_back(in->pop());
+    if (in->eof()) {
+      for (auto &block : held) out->push(std::move(block));
+      held.clear();
+      out->close();
+    }
+  }
+
+ private:
+  StreamPortPtr<std::vector<float>> in;
+  StreamPortPtr<std::vector<float>> out;
+  std::vector<std::vector<float>> held;
+};
+
+TEST_CASE("streaming back-pressure does not deadlock") {
+  // mix needs blocks from both paths, but hold does not output anything until
+  // it has everything, so the direct path has to hold more than its capacity
+  auto run = [](const PlanOptions &options) {
+    Graph g;
+    auto source = g.add_process<SequenceSource>("source", 50, 16);
+    auto hold = g.add_process<Hold>("hold");
+    auto mix = g.add_process<Mix>("mix");
+    auto collect = g.add_process<Collect>("collect");
+    auto sink = g.add_process<DataSink<std::vector<float>>>("sink");
+    mix->get_in_port<StreamPort<std::vector<float>>>("in1")->set_capacity(4);
+
+    g.connect(source->get_out_port("out"), mix->get_in_port("in1"));
+    g.connect(source->get_out_port("out"), hold->get_in_port("in"));
+    g.connect(hold->get_out_port("out"), mix->get_in_port("in2"));
+    g.connect(mix->get_out_port("out"), collect->get_in_port("in"));
+    g.connect(collect->get_out_port("out"), sink->get_in_port("in"));
+
+    evaluate(g, options);
+    return sink->get_value();
+  };
+
+  PlanOptions serial_options;
+  auto serial = run(serial_options);
+  REQUIRE(serial.size() == 50 * 16);
+
+  PlanOptions threaded_options;
+  threaded_options.threaded_streaming = true;
+  REQUIRE(run(threaded_options) == serial);
+}
+
+/// counts calls to process(), discarding the input
+class CountCalls : public StreamingAtomicProcess {
+ public:
+  CountCalls(const std::string &name)
+      : StreamingAtomicProcess(name), in(add_in_port<StreamPort<std::vector<float>>>("in")) {}
+
+  void process() override {
+    n_calls++;
+    while (in->available()) in->pop();
+  }
+
+  StreamPortPtr<std::vector<float>> in;
+  size_t n_calls = 0;
+};
+
+TEST_CASE("streaming only calls ready processes") {
+  // count does not receive anything until hold has seen all blocks from the
+  // source, so should not be called while the source is running
+  Graph g;
+  auto source = g.add_process<SequenceSource>("source", 200, 16);
+  auto hold = g.add_process<Hold>("hold");
+  auto count = g.add_process<CountCalls>("count");
+
+  g.connect(source->get_out_port("out"), hold->get_in_port("in"));
+  g.connect(hold->get_out_port("out"), count->get_in_port("in"));
+
+  PlanOptions options;
+  options.threaded_streaming = GENERATE(false, true);
+  evaluate(g, options);
+
+  REQUIRE(count->n_calls >= 2);
+  REQUIRE(count->n_calls <= 4);
+}
+
+using SharedBlock = ValuePtr<std::vector<float>>;
+
+/// pushes n_blocks blocks containing their index
+class SharedBlockSource : public StreamingAtomicProcess {
+ public:
+  SharedBlockSource(const std::string &name, size_t n_blocks_)
+      : StreamingAtomicProcess(name), out(add_out_port<StreamPort<SharedBlock>>("out")), n_blocks(n_blocks_) {}
+
+  void process() override {
+    if (block_idx < n_blocks) {
+      out->push(std::make_shared<std::vector<float>>(16, static_cast<float>(block_idx)));
+      block_idx++;
+    } else
+      out->close();
+  }
+
+ private:
+  StreamPortPtr<SharedBlock> out;
+  size_t n_blocks;
+  size_t block_idx = 0;
+};
+
+/// sums the samples in the blocks, either reading them or negating them in-place
+class SharedBlockSum : public StreamingAtomicProcess {
+ public:
+  SharedBlockSum(const std::string &name, bool modify_)
+      : StreamingAtomicProcess(name),
+        in(add_in_port<StreamPort<SharedBlock>>("in")),
+        out(add_out_port<DataPort<float>>("out")),
+        modify(modify_) {
+    if (!modify) in->set_read_only();
+  }
+
+  void process() override {
+    while (in->available()) {
+      auto block = in->pop();
+      if (modify) {
+        auto samples = block.move_or_copy();
+        for (auto &sample : *samples) sample = -sample;
+        for (auto sample : *samples) sum -= sample;
+      } else
+        for (auto sample : *block.read()) sum += sample;
+    }
+  }
+
+  void finalise() override { out->set_value(sum); }
+
+  StreamPortPtr<SharedBlock> in;
+  DataPortPtr<float> out;
+  bool modify;
+  float sum = 0.0f;
+};
+
+TEST_CASE("streaming shared items") {
+  // one source connected to two summing processes, which either modify the
+  // blocks or read them
+  bool modify_a = GENERATE(false, true);
+  bool modify_b = GENERATE(false, true);
+
+  Graph g;
+  auto source = g.add_process<SharedBlockSource>("source", 10);
+  auto sum_a = g.add_process<SharedBlockSum>("sum_a", modify_a);
+  auto sum_b = g.add_process<SharedBlockSum>("sum_b", modify_b);
+  auto out_a = g.add_process<DataSink<float>>("out_a");
+  auto out_b = g.add_process<DataSink<float>>("out_b");
+
+  g.connect(source->get_out_port("out"), sum_a->get_in_port("in"));
+  g.connect(source->get_out_port("out"), sum_b->get_in_port("in"));
+  g.connect(sum_a->get_out_port("out"), out_a->get_in_port("in"));
+  g.connect(sum_b->get_out_port("out"), out_b->get_in_port("in"));
+
+  evaluate(g);
+
+  // modifications are not visible to the other process
+  REQUIRE(out_a->get_value() == 16.0f * 45.0f);
+  REQUIRE(out_b->get_value() == 16.0f * 45.0f);
+
+  size_t copies = sum_a->in->shared_pop_count() + sum_b->in->shared_pop_count();
+  if (modify_a && modify_b)
+    // one of them has to copy each block
+    REQUIRE(copies == 10);
+  else
+    // the reader is ran first, so the other can take ownership
+    REQUIRE(copies == 0);
+}
+
+/// pushes n_messages Numbers
+class NumberSource : public StreamingAtomicProcess {
+ public:
+  NumberSource(const std::string &name, int n_messages_)
+      : StreamingAtomicProcess(name), out(add_out_port<StreamPort<Number>>("out")), n_messages(n_messages_) {}
+
+  void process() override {
+    if (message_idx < n_messages)
+      out->push(Number{message_idx++});
+    else
+      out->close();
+  }
+
+ private:
+  StreamPortPtr<Number> out;
+  int n_messages;
+  int message_idx = 0;
+};
+
+TEST_CASE("streaming conversions") {
+  Graph g;
+
+  // one Number output connected to two string inputs
+  auto source = g.add_process<NumberSource>("source", 3);
+  auto data = g.add_process<DataSource<std::string>>("data", "x");
+  auto in = g.add_process<StreamAndDataIn>("in");
+  auto count = g.add_process<CountMessages>("count");
+  auto in_out_stream = g.add_process<DataSink<std::string>>("in_out_stream");
+  auto in_out_data = g.add_process<NullSink<std::string>>("in_out_data");
+  auto count_out = g.add_process<DataSink<int>>("count_out");
+
+  g.connect(source->get_out_port("out"), in->get_in_port("in_stream"));
+  g.connect(source->get_out_port("out"), count->get_in_port("in"));
+  g.connect(data->get_out_port("out"), in->get_in_port("in_data"));
+  g.connect(in->get_out_port("out_stream"), in_out_stream->get_in_port("in"));
+  g.connect(in->get_out_port("out_data"), in_out_data->get_in_port("in"));
+  g.connect(count->get_out_port("out"), count_out->get_in_port("in"));
+
+  // Number can only be converted to string
+  {
+    Graph other;
+    auto other_source = other.add_process<NumberSource>("source", 3);
+    auto filter = other.add_process<Filter>("filter", 0.5f);
+    REQUIRE_THROWS_AS(other.connect(other_source->get_out_port("out"), filter->get_in_port("in")),
+                      std::runtime_error);
+  }
+
+  Plan p = plan(g);
+
+  // the items are converted once for both inputs
+  size_t n_converters = 0;
+  for (auto &process : p.graph().get_processes())
+    if (std::dynamic_pointer_cast<NumberToString>(process)) n_converters++;
+  REQUIRE(n_converters == 1);
+
+  p.run();
+
+  REQUIRE(in_out_stream->get_value() == "in.stream(0, 1, 2)");
+  REQUIRE(count_out->get_value() == 3);
+}
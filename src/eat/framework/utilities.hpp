@@ -1,5 +1,7 @@
 #pragma once
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 #include "eat/framework/exceptions.hpp"
 #include "eat/framework/process.hpp"
@@ -15,8 +17,8 @@ std::shared_ptr<T> checked_dynamic_pointer_cast(U &&ptr) {
 }
 
 // functions that make working with graphs a bit nicer. generally these are
-// hideously inefficient for what they do, but could be improved with a better
-// Graph API, or some acceleration structure on top of Graph
+// hideously inefficient for what they do, so anything which calls them
+// repeatedly should use GraphIndex (below) instead
 //
 // these also assume that the graph has been flattened
 
@@ -94,4 +96,87 @@ inline std::vector<Connection> input_connections(const Graph &g, const ProcessPt
   return out;
 }
 
+/// acceleration structure for a flattened graph, equivalent to the functions
+/// above, but with each lookup taking constant time
+///
+/// this refers to the graph, which must outlive the index and must not be
+/// changed while it is in use
+class GraphIndex {
+ public:
+  explicit GraphIndex(const Graph &g) : graph_(g) {
+    for (auto &process : g.get_processes()) {
+      for (auto &[name, port] : process->get_in_port_map()) in_port_process[port.get()] = process;
+      for (auto &[name, port] : process->get_out_port_map()) out_port_process[port.get()] = process;
+    }
+
+    for (auto &[downstream_port, upstream_port] : g.get_port_inputs()) {
+      connected_ports_[upstream_port.get()].push_back(downstream_port);
+
+      auto upstream_process = process_for_out_port(upstream_port);
+      auto downstream_process = process_for_in_port(downstream_port);
+      if (upstream_process && downstream_process)
+        output_connections_[upstream_process.get()].push_back(
+            {upstream_process, downstream_process, upstream_port, downstream_port});
+    }
+
+    for (auto &process : g.get_processes()) {
+      auto &connections = input_connections_[process.get()];
+      connections.clear();
+
+      for (auto &[name, port] : process->get_in_port_map()) {
+        auto it = g.get_port_inputs().find(port);
+        always_assert(it != g.get_port_inputs().end(), "port not connected");
+        PortPtr upstream_port = it->second;
+
+        ProcessPtr upstream_process = process_for_out_port(upstream_port);
+        always_assert(static_cast<bool>(upstream_process), "port not associated with process");
+
+        connections.push_back({upstream_process, process, upstream_port, port});
+      }
+    }
+  }
+
+  const Graph &graph() const { return graph_; }
+
+  /// ports connected to port
+  const std::vector<PortPtr> &connected_ports(const PortPtr &port) const {
+    return lookup(connected_ports_, port.get());
+  }
+
+  /// get the process associated with an output port. may return null
+  ProcessPtr process_for_out_port(const PortPtr &port) const {
+    auto it = out_port_process.find(port.get());
+    return it != out_port_process.end() ? it->second : ProcessPtr{};
+  }
+
+  /// get the process associated with an input port. may return null
+  ProcessPtr process_for_in_port(const PortPtr &port) const {
+    auto it = in_port_process.find(port.get());
+    return it != in_port_process.end() ? it->second : ProcessPtr{};
+  }
+
+  const std::vector<Connection> &output_connections(const ProcessPtr &process) const {
+    return lookup(output_connections_, process.get());
+  }
+
+  const std::vector<Connection> &input_connections(const ProcessPtr &process) const {
+    return lookup(input_connections_, process.get());
+  }
+
+ private:
+  template <typename K, typename V>
+  static const std::vector<V> &lookup(const std::unordered_map<const K *, std::vector<V>> &map, const K *key) {
+    static const std::vector<V> empty;
+    auto it = map.find(key);
+    return it != map.end() ? it->second : empty;
+  }
+
+  const Graph &graph_;
+  std::unordered_map<const Port *, ProcessPtr> in_port_process;
+  std::unordered_map<const Port *, ProcessPtr> out_port_process;
+  std::unordered_map<const Port *, std::vector<PortPtr>> connected_ports_;
+  std::unordered_map<const Process *, std::vector<Connection>> output_connections_;
+  std::unordered_map<const Process *, std::vector<Connection>> input_connections_;
+};
+
 }  // namespace eat::framework
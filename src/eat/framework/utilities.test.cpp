@@ -79,3 +79,37 @@ TEST_CASE("input_connections") {
 
   REQUIRE(input_connections(g, out).size() == 0);
 }
+
+TEST_CASE("GraphIndex") {
+  Graph g;
+  auto out = g.add_process<HasOutput>("out");
+  auto in1 = g.add_process<HasInput>("in1");
+  auto in2 = g.add_process<HasInput>("in2");
+
+  g.connect(out->get_out_port("out"), in1->get_in_port("in"));
+  g.connect(out->get_out_port("out"), in2->get_in_port("in"));
+
+  GraphIndex index(g);
+
+  REQUIRE(index.process_for_out_port(out->get_out_port("out")) == out);
+  REQUIRE(index.process_for_in_port(in1->get_in_port("in")) == in1);
+  REQUIRE(!index.process_for_in_port(out->get_out_port("out")));
+  REQUIRE(!index.process_for_out_port(in1->get_in_port("in")));
+
+  REQUIRE(index.connected_ports(out->get_out_port("out")) == connected_ports(g, out->get_out_port("out")));
+  REQUIRE(index.connected_ports(in1->get_in_port("in")).empty());
+
+  // should be the same as the non-indexed versions
+  auto same_connections = [](const std::vector<Connection> &a, const std::vector<Connection> &b) {
+    auto key = [](const Connection &c) { return std::make_pair(c.upstream_port, c.downstream_port); };
+    std::set<std::pair<PortPtr, PortPtr>> a_keys, b_keys;
+    for (auto &c : a) a_keys.insert(key(c));
+    for (auto &c : b) b_keys.insert(key(c));
+    return a.size() == b.size() && a_keys == b_keys;
+  };
+
+  for (auto &process : g.get_processes()) {
+    REQUIRE(same_connections(index.output_connections(process), output_connections(g, process)));
+    REQUIRE(same_connections(index.input_connections(process), input_connections(g, process)));
+  }
+}
@@ -0,0 +1,152 @@
+#include "eat/process/adm_bw64.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../utilities/synthetic.hpp"
+#include "eat/framework/evaluate.hpp"
+#include "eat/framework/utility_processes.hpp"
+#include "eat/process/block.hpp"
+#include "eat/testing/files.hpp"
+
+using namespace eat::framework;
+using namespace eat::process;
+using namespace eat::testing;
+using namespace eat::utilities;
+
+TEST_CASE("bench bw64 read and write") {
+  TempDir dir;
+  const size_t n_channels = 16;
+  const unsigned int sample_rate = 48000;
+  const size_t n_frames = 10 * sample_rate;
+  const size_t block_size = 1024;
+
+  auto samples = make_synthetic_samples(n_channels, n_frames);
+  const std::string in_path = (dir / "in.wav").string();
+  write_synthetic_bw64(in_path, samples, n_channels, sample_rate);
+
+  BENCHMARK_ADVANCED("read_bw64 16 channels 10s")(Catch::Benchmark::Chronometer meter) {
+    measure_run(meter, [&]() {
+      Graph g;
+      auto reader = g.register_process(make_read_bw64("reader", in_path, block_size));
+      auto sink = g.add_process<DiscardSamples>("sink");
+      g.connect(reader->get_out_port("out_samples"), sink->get_in_port("in_samples"));
+      return g;
+    });
+  };
+
+  BENCHMARK_ADVANCED("read_bw64 4 of 16 channels 10s")(Catch::Benchmark::Chronometer meter) {
+    measure_run(meter, [&]() {
+      Graph g;
+      auto reader = g.register_process(make_read_bw64("reader", in_path, block_size, 0, {0, 1, 2, 3}));
+      auto sink = g.add_process<DiscardSamples>("sink");
+      g.connect(reader->get_out_port("out_samples"), sink->get_in_port("in_samples"));
+      return g;
+    });
+  };
+
+  // the input is 24 bit, so this is a passthrough; writing float32 needs
+  // the samples to be decoded
+  BENCHMARK_ADVANCED("copy_bw64 passthrough 16 channels 10s")(Catch::Benchmark::Chronometer meter) {
+    measure_run(meter, [&]() {
+      Graph g;
+      auto reader = g.register_process(make_read_bw64("reader", in_path, block_size));
+      auto writer = g.register_process(make_write_bw64("writer", (dir / "copy.wav").string()));
+      g.connect(reader->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+      return g;
+    });
+  };
+
+  BENCHMARK_ADVANCED("copy_bw64 decoded 16 channels 10s")(Catch::Benchmark::Chronometer meter) {
+    measure_run(meter, [&]() {
+      Graph g;
+      auto reader = g.register_process(make_read_bw64("reader", in_path, block_size));
+      auto writer =
+          g.register_process(make_write_bw64("writer", (dir / "copy.wav").string(), 0, SampleFormat::Float32));
+      g.connect(reader->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+      return g;
+    });
+  };
+
+  const std::vector<std::pair<std::string, SampleFormat>> formats = {
+      {"int16", SampleFormat::Int16},
+      {"int24", SampleFormat::Int24},
+      {"int32", SampleFormat::Int32},
+      {"float32", SampleFormat::Float32},
+  };
+
+  for (auto &format : formats) {
+    BENCHMARK_ADVANCED("write_bw64 " + format.first + " 16 channels 10s")(Catch::Benchmark::Chronometer meter) {
+      measure_run(meter, [&]() {
+        Graph g;
+        auto source = g.add_process<InterleavedStreamingAudioSource>(
+            "source", samples, BlockDescription{block_size, n_channels, sample_rate});
+        auto writer = g.register_process(make_write_bw64("writer", (dir / "out.wav").string(), 0, format.second));
+        g.connect(source->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+        return g;
+      });
+    };
+  }
+}
+
+TEST_CASE("bench adm read and write") {
+  TempDir dir;
+  const unsigned int sample_rate = 48000;
+  const size_t block_size = 1024;
+
+  // serial-ADM-style: many short blocks per object, making a large document
+  SyntheticADMOptions options;
+  options.n_objects = 32;
+  options.duration = std::chrono::minutes{10};
+  options.block_duration = std::chrono::milliseconds{20};
+  const std::string desc = std::to_string(options.n_objects) + " objects 10min 20ms blocks";
+
+  ADMData adm = make_synthetic_adm(options);
+  const size_t n_channels = synthetic_channel_count(options);
+  // the samples are not important here, so keep them short
+  auto samples = make_synthetic_samples(n_channels, sample_rate);
+
+  const std::string in_path = (dir / "in.wav").string();
+  write_synthetic_bw64(in_path, samples, n_channels, sample_rate, &adm);
+
+  auto make_read_graph = [&]() {
+    Graph g;
+    auto reader = g.register_process(make_read_adm_bw64("reader", in_path, block_size));
+    auto samples_sink = g.add_process<DiscardSamples>("samples_sink");
+    auto adm_sink = g.add_process<NullSink<ADMData>>("adm_sink");
+    g.connect(reader->get_out_port("out_samples"), samples_sink->get_in_port("in_samples"));
+    g.connect(reader->get_out_port("out_axml"), adm_sink->get_in_port("in"));
+    return g;
+  };
+
+  auto make_write_graph = [&]() {
+    Graph g;
+    auto adm_source = g.add_process<DataSource<ADMData>>("adm_source", adm);
+    auto samples_source = g.add_process<InterleavedStreamingAudioSource>(
+        "samples_source", samples, BlockDescription{block_size, n_channels, sample_rate});
+    auto writer = g.register_process(make_write_adm_bw64("writer", (dir / "out.wav").string()));
+    g.connect(adm_source->get_out_port("out"), writer->get_in_port("in_axml"));
+    g.connect(samples_source->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+    return g;
+  };
+
+  // peak memory is not something Catch can measure, so report it
+  // separately, for one run of each graph
+  auto report_peak_memory = [&](const std::string &name, Graph g) {
+    Plan p = plan(g);
+    PeakMemory peak;
+    p.run();
+    if (auto bytes = peak.measure())
+      WARN("peak memory for " << name << " " << desc << ": " << *bytes / (1024 * 1024) << " MiB");
+  };
+  report_peak_memory("read_adm_bw64", make_read_graph());
+  report_peak_memory("write_adm_bw64", make_write_graph());
+
+  BENCHMARK_ADVANCED("read_adm_bw64 " + desc)(Catch::Benchmark::Chronometer meter) {
+    measure_run(meter, make_read_graph);
+  };
+
+  BENCHMARK_ADVANCED("write_adm_bw64 " + desc)(Catch::Benchmark::Chronometer meter) {
+    measure_run(meter, make_write_graph);
+  };
+}
@@ -4,128 +4,511 @@
 #include <adm/parse.hpp>
 #include <adm/write.hpp>
 #include <bw64/bw64.hpp>
+#include <bw64/parser.hpp>
+#include <bw64/utils.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <set>
+#include <streambuf>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 #include "eat/framework/exceptions.hpp"
 #include "eat/process/block.hpp"
 #include "eat/process/chna.hpp"
+#include "block_queue.hpp"
+#include "mapped_wav.hpp"
+#include "wav_writer.hpp"
 
 using namespace eat::framework;
 using namespace eat::process;
 
 namespace {
 
+/// an input streambuf which reads from memory without copying it
+class ViewStreambuf : public std::streambuf {
+ public:
+  explicit ViewStreambuf(std::string_view data) {
+    // the data is never written through the get area
+    char *begin = const_cast<char *>(data.data());
+    setg(begin, begin, begin + data.size());
+  }
+};
+
+/// keep only the tracks in channels, numbering them by their position in
+/// channels (to match the output of an AudioReader with the same channels);
+/// audioTrackUids for other channels are removed from document
+void select_channels(adm::Document &document, channel_map_t &channel_map, const std::vector<size_t> &channels) {
+  std::map<size_t, size_t> new_channels;
+  for (size_t i = 0; i < channels.size(); i++) new_channels.emplace(channels[i], i);
+
+  channel_map_t selected;
+  std::set<adm::AudioTrackUidId> removed;
+  for (auto &[id, channel] : channel_map) {
+    if (auto it = new_channels.find(channel); it != new_channels.end())
+      selected.emplace(id, it->second);
+    else
+      removed.insert(id);
+  }
+
+  // iterate twice because removing would invalidate the range
+  std::vector<std::shared_ptr<adm::AudioTrackUid>> to_remove;
+  for (const auto &uid : document.getElements<adm::AudioTrackUid>())
+    if (removed.count(uid->get<adm::AudioTrackUidId>())) to_remove.push_back(uid);
+  for (const auto &uid : to_remove) document.remove(uid);
+
+  channel_map = std::move(selected);
+}
+
+/// the frames [first, second) of a file with n_frames frames covered by range
+std::pair<size_t, size_t> range_frames(const TimeRange &range, unsigned int sample_rate, size_t n_frames) {
+  auto to_frames = [&](double seconds) {
+    return static_cast<size_t>(std::llround(std::max(seconds, 0.0) * static_cast<double>(sample_rate)));
+  };
+
+  size_t start = std::min(to_frames(range.start), n_frames);
+  size_t end = range.duration ? std::min(start + to_frames(*range.duration), n_frames) : n_frames;
+  return {start, end};
+}
+
+/// the time of a frame, as in ADMData::start; whole seconds are converted
+/// separately, so that this does not overflow for long files
+std::chrono::nanoseconds frame_time(size_t frame, unsigned int sample_rate) {
+  auto seconds = static_cast<int64_t>(frame / sample_rate);
+  auto remainder = static_cast<int64_t>(frame % sample_rate);
+  auto remainder_ns = (remainder * 1000000000 + sample_rate / 2) / sample_rate;
+  return std::chrono::seconds{seconds} + std::chrono::nanoseconds{remainder_ns};
+}
+
+/// read the ADM data from a file
+///
+/// if possible the file is mapped, and the axml and chna chunks are parsed
+/// straight from the mapping; otherwise libbw64 is used, which reads the axml
+/// chunk into memory first
+///
+/// if channels is not empty, only tracks in these channels are kept (see
+/// select_channels). the start of range is stored in ADMData::start, to match
+/// an AudioReader with the same range
 class ADMReader : public FunctionalAtomicProcess {
  public:
-  ADMReader(const std::string &name, const std::string &path_)
-      : FunctionalAtomicProcess(name), path(path_), out_axml(add_out_port<DataPort<ADMData>>("out_axml")) {}
+  ADMReader(const std::string &name, const std::string &path_, std::vector<size_t> channels_ = {},
+            const TimeRange &range_ = {})
+      : FunctionalAtomicProcess(name),
+        path(path_),
+        channels(std::move(channels_)),
+        range(range_),
+        out_axml(add_out_port<DataPort<ADMData>>("out_axml")) {}
 
   void process() override {
+    if (!read_mapped()) read_bw64();
+  }
+
+ private:
+  bool read_mapped() {
+    auto reader = MappedWavReader::open(path);
+    if (!reader) return false;
+
+    auto axml = reader->chunk("axml");
+    auto chna = reader->chunk("chna");
+    if (!axml || !chna) return false;
+
+    ViewStreambuf axml_buf(*axml);
+    std::istream axml_stream(&axml_buf);
+
+    ViewStreambuf chna_buf(*chna);
+    std::istream chna_stream(&chna_buf);
+    auto chna_chunk = bw64::parseChnaChunk(chna_stream, bw64::utils::fourCC("chna"), chna->size());
+
+    load(axml_stream, *chna_chunk, reader->sample_rate(), reader->number_of_frames());
+    return true;
+  }
+
+  void read_bw64() {
     auto file = bw64::readFile(path);
     std::stringstream axml;
     file->axmlChunk()->write(axml);
     axml.seekg(0);
 
+    load(axml, *file->chnaChunk(), file->sampleRate(), file->numberOfFrames());
+  }
+
+  void load(std::istream &axml, const bw64::ChnaChunk &chna, unsigned int sample_rate, size_t n_frames) {
     ADMData adm;
+    adm.start = frame_time(range_frames(range, sample_rate, n_frames).first, sample_rate);
 
     auto doc = adm::parseXml(axml);
-    load_chna(*doc, adm.channel_map, *file->chnaChunk());
+    load_chna(*doc, adm.channel_map, chna);
+    if (!channels.empty()) select_channels(*doc, adm.channel_map, channels);
     adm.document = std::move(doc);
 
     out_axml->set_value(std::move(adm));
   }
 
- private:
   std::string path;
+  std::vector<size_t> channels;
+  TimeRange range;
   DataPortPtr<ADMData> out_axml;
 };
 
+/// the samples in (part of) a file, which AudioReader outputs and AudioWriter
+/// can copy directly
+struct FileSamples : public PassthroughSource {
+  FileSamples(const std::string &path_, const TimeRange &range_) : path(path_), range(range_) {}
+  std::string path;
+  TimeRange range;
+};
+
+/// read samples from a file, using MappedWavReader if possible, or libbw64
+/// otherwise (e.g. for unsupported formats, or if mapping fails)
+///
+/// if read_ahead is not 0, blocks are read on a background thread, with up to
+/// read_ahead blocks waiting to be pushed, so that reads overlap with the
+/// processing of earlier blocks
+///
+/// if channels is not empty, only these channels are output, and (when using
+/// MappedWavReader) only these channels are decoded
+///
+/// only the frames in range are read, seeking straight to the start
 class AudioReader : public StreamingAtomicProcess {
  public:
-  AudioReader(const std::string &name, const std::string &path_, size_t block_size_)
+  AudioReader(const std::string &name, const std::string &path_, size_t block_size_, size_t read_ahead_,
+              std::vector<size_t> channels_, const TimeRange &range_)
       : StreamingAtomicProcess(name),
         path(path_),
         block_size(block_size_),
+        read_ahead(read_ahead_),
+        channels(std::move(channels_)),
+        range(range_),
         out_samples(add_out_port<StreamPort<InterleavedBlockPtr>>("out_samples")) {
     always_assert(block_size > 0, "block size must be > 0");
   }
 
-  void initialise() override { file = bw64::readFile(path); }
+  ~AudioReader() { stop_read_ahead(); }
+
+  void initialise() override {
+    mapped = MappedWavReader::open(path);
+    if (!mapped) file = bw64::readFile(path);
+    unsigned int sample_rate = mapped ? mapped->sample_rate() : file->sampleRate();
+    size_t file_frames = mapped ? mapped->number_of_frames() : file->numberOfFrames();
+    auto [start, end] = range_frames(range, sample_rate, file_frames);
+    if (mapped) {
+      mapped->seek(start);
+    } else if (start) {
+      // libbw64 takes a 32-bit offset
+      if (start > static_cast<size_t>(std::numeric_limits<int32_t>::max()))
+        throw std::runtime_error("can not seek to frame " + std::to_string(start) + " of " + path +
+                                 " without a memory mapping");
+      file->seek(static_cast<int32_t>(start));
+    }
+    n_frames = end - start;
+    frames_pushed = 0;
+    frames_read = 0;
+
+    size_t file_channels = mapped ? mapped->channels() : file->channels();
+    for (auto channel : channels)
+      if (channel >= file_channels)
+        throw std::runtime_error("channel " + std::to_string(channel) + " requested from " + path + ", which has " +
+                                 std::to_string(file_channels) + " channels");
+
+    if (read_ahead) {
+      queue = std::make_unique<BlockQueue<std::shared_ptr<InterleavedSampleBlock>>>(read_ahead);
+      read_error = nullptr;
+      read_thread = std::thread([this]() {
+        try {
+          while (auto samples = read_block()) {
+            // make sure that views of the mapping have been read from disk
+            touch(*samples);
+            if (!queue->push(std::move(samples))) break;
+          }
+        } catch (...) {
+          read_error = std::current_exception();
+        }
+        queue->close();
+      });
+    }
+  }
 
   void process() override {
-    std::vector<float> buffer(block_size * file->channels());
-    size_t n_frames = file->read(buffer.data(), block_size);
+    std::shared_ptr<InterleavedSampleBlock> samples;
+    if (read_ahead) {
+      if (!queue->pop(samples) && read_error) std::rethrow_exception(read_error);
+    } else
+      samples = read_block();
 
-    if (n_frames > 0) {
-      buffer.resize(n_frames * file->channels());
-      auto samples = std::make_shared<InterleavedSampleBlock>(
-          std::move(buffer), BlockDescription{n_frames, file->channels(), file->sampleRate()});
+    if (samples) {
+      frames_pushed += samples->info().sample_count;
       out_samples->push(std::move(samples));
     } else
       out_samples->close();
   }
 
-  void finalise() override { file.reset(); }
+  void finalise() override {
+    stop_read_ahead();
+    mapped.reset();
+    file.reset();
+  }
+
+  bool is_duplicable() const override { return true; }
+
+  StreamingAtomicProcessPtr duplicate(const std::string &name) const override {
+    return std::make_shared<AudioReader>(name, path, block_size, read_ahead, channels, range);
+  }
+
+  PassthroughSourcePtr passthrough_source(const std::string &) const override {
+    // the output is not the samples in the file if some channels are dropped
+    if (!channels.empty()) return nullptr;
+    return std::make_shared<FileSamples>(path, range);
+  }
 
   std::optional<float> get_progress() override {
-    if (file && file->numberOfFrames())
-      return static_cast<float>(file->tell()) / static_cast<float>(file->numberOfFrames());
+    if ((mapped || file) && n_frames)
+      return static_cast<float>(frames_pushed) / static_cast<float>(n_frames);
     else
       return std::nullopt;
   }
 
  private:
+  /// read the next block, or return nullptr at the end of the range
+  std::shared_ptr<InterleavedSampleBlock> read_block() {
+    size_t to_read = std::min(block_size, n_frames - frames_read);
+    if (!to_read) return nullptr;
+
+    if (mapped) {
+      auto samples = mapped->read(to_read, channels);
+      if (samples) frames_read += samples->info().sample_count;
+      return samples;
+    }
+
+    std::vector<float> buffer(to_read * file->channels());
+    size_t frames = file->read(buffer.data(), to_read);
+    if (!frames) return nullptr;
+    frames_read += frames;
+
+    buffer.resize(frames * file->channels());
+    if (channels.empty())
+      return std::make_shared<InterleavedSampleBlock>(std::move(buffer),
+                                                      BlockDescription{frames, file->channels(), file->sampleRate()});
+
+    std::vector<float> selected(frames * channels.size());
+    for (size_t frame = 0; frame < frames; frame++)
+      for (size_t i = 0; i < channels.size(); i++)
+        selected[frame * channels.size() + i] = buffer[frame * file->channels() + channels[i]];
+    return std::make_shared<InterleavedSampleBlock>(std::move(selected),
+                                                    BlockDescription{frames, channels.size(), file->sampleRate()});
+  }
+
+  /// read one sample from each page of samples, so that any page faults
+  /// happen on the calling thread
+  static void touch(const InterleavedSampleBlock &samples) {
+    constexpr size_t page_samples = 4096 / sizeof(float);
+    size_t n = samples.info().sample_count * samples.info().channel_count;
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; i += page_samples) sum += samples.data()[i];
+    volatile float sink = sum;
+    (void)sink;
+  }
+
+  void stop_read_ahead() {
+    if (read_thread.joinable()) {
+      queue->cancel();
+      read_thread.join();
+    }
+    queue.reset();
+  }
+
   std::string path;
   size_t block_size;
+  size_t read_ahead;
+  std::vector<size_t> channels;
+  TimeRange range;
   StreamPortPtr<InterleavedBlockPtr> out_samples;
 
+  std::unique_ptr<MappedWavReader> mapped;
   std::shared_ptr<bw64::Bw64Reader> file;
+  /// number of frames in the range
+  size_t n_frames = 0;
+  /// frames read by read_block(), which may be on the read-ahead thread
+  size_t frames_read = 0;
+  size_t frames_pushed = 0;
+
+  std::unique_ptr<BlockQueue<std::shared_ptr<InterleavedSampleBlock>>> queue;
+  std::thread read_thread;
+  std::exception_ptr read_error;
+};
+
+/// copy the samples from one file to another without decoding them, for
+/// AudioWriter::passthrough
+class SampleCopier : public FunctionalAtomicProcess {
+ public:
+  SampleCopier(const std::string &name, const std::string &in_path_, const TimeRange &range_,
+               const std::string &out_path_, bool has_out_file, SampleFormat format_)
+      : FunctionalAtomicProcess(name),
+        in_path(in_path_),
+        range(range_),
+        out_path(out_path_),
+        format(format_),
+        out_file(has_out_file ? add_out_port<DataPort<std::shared_ptr<WavWriter>>>("out_file") : nullptr) {}
+
+  void process() override {
+    auto reader = MappedWavReader::open(in_path);
+    if (!reader) throw std::runtime_error("could not read samples from " + in_path);
+    if (reader->sample_format() != format) throw std::runtime_error("sample format of " + in_path + " changed");
+
+    auto [start, end] = range_frames(range, reader->sample_rate(), reader->number_of_frames());
+    size_t frame_size = reader->frame_size();
+
+    auto file = std::make_shared<WavWriter>(out_path, reader->channels(), reader->sample_rate(), format);
+    file->copy_samples(in_path, reader->samples_offset() + start * frame_size, (end - start) * frame_size);
+
+    if (out_file)
+      out_file->set_value(std::move(file));
+    else
+      file->close();
+  }
+
+ private:
+  std::string in_path;
+  TimeRange range;
+  std::string out_path;
+  SampleFormat format;
+  DataPortPtr<std::shared_ptr<WavWriter>> out_file;
 };
 
+/// write samples to a file in the given format
+///
+/// if write_behind is not 0, blocks are written on a background thread, with
+/// up to write_behind blocks waiting; blocks which are waiting at the same time
+/// are combined into one write. the file is complete once finalise() returns
+///
+/// if the samples come straight from an AudioReader reading a file with the
+/// same format, this is replaced by a SampleCopier before running
 class AudioWriter : public StreamingAtomicProcess {
  public:
-  AudioWriter(const std::string &name, const std::string &path_, bool has_out_file)
+  AudioWriter(const std::string &name, const std::string &path_, bool has_out_file, size_t write_behind_,
+              SampleFormat format_)
       : StreamingAtomicProcess(name),
         path(path_),
+        write_behind(write_behind_),
+        format(format_),
         in_samples(add_in_port<StreamPort<InterleavedBlockPtr>>("in_samples")),
-        out_file(has_out_file ? add_out_port<DataPort<std::shared_ptr<bw64::Bw64Writer>>>("out_file") : nullptr) {}
+        out_file(has_out_file ? add_out_port<DataPort<std::shared_ptr<WavWriter>>>("out_file") : nullptr) {
+    in_samples->set_read_only();
+  }
+
+  void initialise() override {
+    if (write_behind) {
+      auto write = [this](std::vector<SamplesPtr> &batch) { write_batch(batch); };
+      writer = std::make_unique<WriteBehind<SamplesPtr>>(write_behind, write);
+    }
+  }
 
   void process() override {
     while (in_samples->available()) {
       auto samples = in_samples->pop().read();
-      auto &frame_info = samples->info();
-
-      if (!file) {
-        file = bw64::writeFile(path, frame_info.channel_count, frame_info.sample_rate, 24);
-      }
 
-      file->write(samples->data(), frame_info.sample_count);
+      if (writer)
+        writer->push(std::move(samples));
+      else
+        write_block(samples);
     }
   }
 
   void finalise() override {
+    if (writer) {
+      writer->finish();
+      writer.reset();
+    }
+
     if (!file) {
       // TODO: issue warning that we had to guess number of channels and sample rate
-      file = bw64::writeFile(path, 0, 48000, 24);
+      file = std::make_shared<WavWriter>(path, 0, 48000, format);
     }
-    if (out_file)
+    if (out_file) {
       out_file->set_value(std::move(file));
-    else
+    } else {
+      file->close();
       file = nullptr;
+    }
+  }
+
+  ProcessPtr passthrough(const std::string &name, const std::string &, const PassthroughSource &source) const override {
+    auto file_samples = dynamic_cast<const FileSamples *>(&source);
+    if (!file_samples) return nullptr;
+
+    // the output can not be copied from itself; the AudioWriter is kept, and
+    // WavWriter refuses to write over the input while AudioReader has it mapped
+    std::error_code ec;
+    if (std::filesystem::equivalent(file_samples->path, path, ec)) return nullptr;
+
+    // the samples can only be copied if they would not be converted
+    auto reader = MappedWavReader::open(file_samples->path);
+    if (!reader || reader->sample_format() != format) return nullptr;
+
+    return std::make_shared<SampleCopier>(name, file_samples->path, file_samples->range, path,
+                                          static_cast<bool>(out_file), format);
   }
 
  private:
+  using SamplesPtr = std::shared_ptr<const InterleavedSampleBlock>;
+
+  void open(const BlockDescription &frame_info) {
+    if (!file) file = std::make_shared<WavWriter>(path, frame_info.channel_count, frame_info.sample_rate, format);
+  }
+
+  void write_block(const SamplesPtr &samples) {
+    auto &frame_info = samples->info();
+    open(frame_info);
+    file->write(samples->data(), frame_info.sample_count);
+  }
+
+  /// write blocks, combining them into one write if there are several
+  void write_batch(std::vector<SamplesPtr> &batch) {
+    if (batch.size() == 1) {
+      write_block(batch.front());
+      return;
+    }
+
+    auto &frame_info = batch.front()->info();
+    open(frame_info);
+
+    size_t n_frames = 0;
+    for (auto &samples : batch) n_frames += samples->info().sample_count;
+
+    buffer.resize(n_frames * frame_info.channel_count);
+    float *out = buffer.data();
+    for (auto &samples : batch) {
+      always_assert(samples->info().channel_count == frame_info.channel_count, "channel count changed mid-stream");
+      size_t n = samples->info().sample_count * frame_info.channel_count;
+      std::copy(samples->data(), samples->data() + n, out);
+      out += n;
+    }
+
+    file->write(buffer.data(), n_frames);
+  }
+
   std::string path;
+  size_t write_behind;
+  SampleFormat format;
   StreamPortPtr<InterleavedBlockPtr> in_samples;
-  DataPortPtr<std::shared_ptr<bw64::Bw64Writer>> out_file;
+  DataPortPtr<std::shared_ptr<WavWriter>> out_file;
 
-  std::shared_ptr<bw64::Bw64Writer> file;
+  std::shared_ptr<WavWriter> file;
+  std::unique_ptr<WriteBehind<SamplesPtr>> writer;
+  /// used to combine blocks in the background thread
+  std::vector<float> buffer;
 };
 
 class ADMWriter : public FunctionalAtomicProcess {
  public:
   ADMWriter(const std::string &name)
       : FunctionalAtomicProcess(name),
-        in_file(add_in_port<DataPort<std::shared_ptr<bw64::Bw64Writer>>>("in_file")),
+        in_file(add_in_port<DataPort<std::shared_ptr<WavWriter>>>("in_file")),
         in_axml(add_in_port<DataPort<ADMData>>("in_axml")) {}
 
   void process() override {
@@ -133,27 +516,27 @@ class ADMWriter : public FunctionalAtomicProcess {
 
     auto adm = std::move(in_axml->get_value());
 
-    std::ostringstream axml_stream;
-    adm::writeXml(axml_stream, adm.document.read());
-
-    auto axml_chunk = std::make_shared<bw64::AxmlChunk>(axml_stream.str());
-    file->setAxmlChunk(std::move(axml_chunk));
+    auto document = adm.document.read();
 
-    file->setChnaChunk(std::make_shared<bw64::ChnaChunk>(make_chna(*adm.document.read(), adm.channel_map)));
+    // the XML is written straight to the file when it is closed
+    file->set_chunk("axml", [document](std::ostream &stream) { adm::writeXml(stream, document); });
+    file->set_chunk(std::make_shared<bw64::ChnaChunk>(make_chna(*document, adm.channel_map)));
+    file->close();
   }
 
  private:
-  DataPortPtr<std::shared_ptr<bw64::Bw64Writer>> in_file;
+  DataPortPtr<std::shared_ptr<WavWriter>> in_file;
   DataPortPtr<ADMData> in_axml;
 };
 
 class ADMWavWriter : public CompositeProcess {
  public:
-  ADMWavWriter(const std::string &name, const std::string &path) : CompositeProcess(name) {
+  ADMWavWriter(const std::string &name, const std::string &path, size_t write_behind, SampleFormat format)
+      : CompositeProcess(name) {
     auto in_axml = add_in_port<DataPort<ADMData>>("in_axml");
     auto in_samples = add_in_port<StreamPort<InterleavedBlockPtr>>("in_samples");
 
-    auto audio_writer = add_process<AudioWriter>("audio writer", path, true);
+    auto audio_writer = add_process<AudioWriter>("audio writer", path, true, write_behind, format);
     auto adm_writer = add_process<ADMWriter>("adm writer");
 
     connect(in_samples, audio_writer->get_in_port("in_samples"));
@@ -165,12 +548,14 @@ class ADMWavWriter : public CompositeProcess {
 
 class ADMWavReader : public CompositeProcess {
  public:
-  ADMWavReader(const std::string &name, const std::string &path, size_t block_size) : CompositeProcess(name) {
+  ADMWavReader(const std::string &name, const std::string &path, size_t block_size, size_t read_ahead,
+               const std::vector<size_t> &channels, const TimeRange &range)
+      : CompositeProcess(name) {
     auto out_axml = add_out_port<DataPort<ADMData>>("out_axml");
     auto out_samples = add_out_port<StreamPort<InterleavedBlockPtr>>("out_samples");
 
-    auto adm_reader = add_process<ADMReader>("adm reader", path);
-    auto audio_reader = add_process<AudioReader>("audio reader", path, block_size);
+    auto adm_reader = add_process<ADMReader>("adm reader", path, channels, range);
+    auto audio_reader = add_process<AudioReader>("audio reader", path, block_size, read_ahead, channels, range);
 
     connect(audio_reader->get_out_port("out_samples"), out_samples);
     connect(adm_reader->get_out_port("out_axml"), out_axml);
@@ -181,24 +566,28 @@ class ADMWavReader : public CompositeProcess {
 
 namespace eat::process {
 
-ProcessPtr make_read_bw64(const std::string &name, const std::string &path, size_t block_size) {
-  return std::make_shared<AudioReader>(name, path, block_size);
+ProcessPtr make_read_bw64(const std::string &name, const std::string &path, size_t block_size, size_t read_ahead,
+                          const std::vector<size_t> &channels, const TimeRange &range) {
+  return std::make_shared<AudioReader>(name, path, block_size, read_ahead, channels, range);
 }
 
-ProcessPtr make_write_bw64(const std::string &name, const std::string &path) {
-  return std::make_shared<AudioWriter>(name, path, false);
+ProcessPtr make_write_bw64(const std::string &name, const std::string &path, size_t write_behind,
+                           SampleFormat format) {
+  return std::make_shared<AudioWriter>(name, path, false, write_behind, format);
 }
 
 ProcessPtr make_read_adm(const std::string &name, const std::string &path) {
   return std::make_shared<ADMReader>(name, path);
 }
 
-ProcessPtr make_read_adm_bw64(const std::string &name, const std::string &path, size_t block_size) {
-  return std::make_shared<ADMWavReader>(name, path, block_size);
+ProcessPtr make_read_adm_bw64(const std::string &name, const std::string &path, size_t block_size,
+                              size_t read_ahead, const std::vector<size_t> &channels, const TimeRange &range) {
+  return std::make_shared<ADMWavReader>(name, path, block_size, read_ahead, channels, range);
 }
 
-ProcessPtr make_write_adm_bw64(const std::string &name, const std::string &path) {
-  return std::make_shared<ADMWavWriter>(name, path);
+ProcessPtr make_write_adm_bw64(const std::string &name, const std::string &path, size_t write_behind,
+                               SampleFormat format) {
+  return std::make_shared<ADMWavWriter>(name, path, write_behind, format);
 }
 
 }  // namespace eat::process
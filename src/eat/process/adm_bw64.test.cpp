@@ -4,18 +4,47 @@
 #include <adm/document.hpp>
 #include <adm/parse.hpp>
 #include <adm/write.hpp>
+#include <algorithm>
+#include <bit>
 #include <bw64/bw64.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <utility>
 
 #include "eat/framework/evaluate.hpp"
+#include "eat/framework/utility_processes.hpp"
 #include "eat/process/block.hpp"
 #include "eat/testing/files.hpp"
+#include "mapped_wav.hpp"
 
 using namespace eat::framework;
 using namespace eat::process;
 using namespace eat::testing;
 using namespace adm;
 
+/// read all samples from a BW64 file
+static std::vector<float> read_samples(const std::string &path) {
+  Graph g;
+  auto reader = g.register_process(make_read_bw64("reader", path, 1000));
+  auto sink = g.add_process<InterleavedStreamingAudioSink>("sink");
+  g.connect(reader->get_out_port("out_samples"), sink->get_in_port("in_samples"));
+  evaluate(g);
+  return sink->get();
+}
+
+/// read the bodies of the axml and chna chunks from a BW64 file
+static std::pair<std::string, std::string> read_adm_chunks(const std::string &path) {
+  auto file = bw64::readFile(path);
+  std::ostringstream axml, chna;
+  file->axmlChunk()->write(axml);
+  file->chnaChunk()->write(chna);
+  return {axml.str(), chna.str()};
+}
+
 TEST_CASE("read and write") {
   TempDir dir;
   auto in = dir / "in.wav";
@@ -74,16 +103,402 @@ TEST_CASE("read and write") {
   {
     Graph g;
     auto reader = g.register_process(make_read_adm_bw64("reader", in.string(), 1024));
-    auto writer = g.register_process(make_write_adm_bw64("writer", in.string()));
+    auto writer = g.register_process(make_write_adm_bw64("writer", out.string()));
 
     g.connect(reader->get_out_port("out_samples"), writer->get_in_port("in_samples"));
     g.connect(reader->get_out_port("out_axml"), writer->get_in_port("in_axml"));
 
     Plan p = plan(g);
+
+    // the samples are not modified, so should be copied directly
+    for (auto &process : p.graph().get_processes()) REQUIRE(process->name() != "audio reader");
+
     p.run();
   }
 
   REQUIRE(files_equal(in.string(), out.string()));
+
+  // writing over the input is an error, rather than truncating it while it
+  // is being read
+  auto before = dir / "before.wav";
+  std::filesystem::copy_file(in, before, std::filesystem::copy_options::overwrite_existing);
+  {
+    Graph g;
+    auto reader = g.register_process(make_read_adm_bw64("reader", in.string(), 1024));
+    auto writer = g.register_process(make_write_adm_bw64("writer", in.string()));
+
+    g.connect(reader->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+    g.connect(reader->get_out_port("out_axml"), writer->get_in_port("in_axml"));
+
+    REQUIRE_THROWS_AS(evaluate(g), std::runtime_error);
+  }
+
+  // the input was neither truncated nor rewritten
+  REQUIRE(files_equal(in.string(), before.string()));
+  REQUIRE(read_samples(in.string()) == read_samples(before.string()));
+  REQUIRE(read_adm_chunks(in.string()) == read_adm_chunks(before.string()));
+  REQUIRE(files_equal(in.string(), out.string()));
+}
+
+TEST_CASE("read_bw64 matches libbw64") {
+  // read_bw64 reads samples through a memory mapping, so check that it
+  // produces the same samples as libbw64 for all supported bit depths, with
+  // and without reading ahead
+  const uint16_t bit_depth = GENERATE(16, 24, 32);
+  const size_t read_ahead = GENERATE(0, 4);
+  const size_t channels = 3;
+  const size_t n_frames = 2500;
+
+  TempDir dir;
+  auto path = (dir / "in.wav").string();
+
+  {
+    std::vector<float> samples(channels * n_frames);
+    for (size_t i = 0; i < samples.size(); i++)
+      samples[i] = static_cast<float>(i % 2001) / 1000.0f - 1.0f + static_cast<float>(i % 7) * 1e-7f;
+
+    auto file = bw64::writeFile(path, channels, 48000, bit_depth);
+    file->write(samples.data(), n_frames);
+  }
+
+  std::vector<float> expected(channels * n_frames);
+  bw64::readFile(path)->read(expected.data(), n_frames);
+
+  Graph g;
+  auto reader = g.register_process(make_read_bw64("reader", path, 1000, read_ahead));
+  auto sink = g.add_process<InterleavedStreamingAudioSink>("sink");
+  g.connect(reader->get_out_port("out_samples"), sink->get_in_port("in_samples"));
+  evaluate(g);
+
+  REQUIRE(sink->get() == expected);
+  REQUIRE(sink->get_block().info().sample_rate == 48000);
+}
+
+TEST_CASE("write_bw64 sample formats") {
+  // write samples in each format, with and without writing behind, and check
+  // that they are read back correctly, including clipping
+  const auto format = GENERATE(SampleFormat::Int16, SampleFormat::Int24, SampleFormat::Int32, SampleFormat::Float32);
+  const size_t write_behind = GENERATE(0, 4);
+  const size_t channels = 3;
+  const size_t n_frames = 2500;
+
+  std::vector<float> samples(channels * n_frames);
+  for (size_t i = 0; i < samples.size(); i++) samples[i] = static_cast<float>(i % 2401) / 1000.0f - 1.2f;
+
+  TempDir dir;
+  auto path = (dir / "out.wav").string();
+  {
+    Graph g;
+    auto source =
+        g.add_process<InterleavedStreamingAudioSource>("source", samples, BlockDescription{100, channels, 48000});
+    auto writer = g.register_process(make_write_bw64("writer", path, write_behind, format));
+    g.connect(source->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+    evaluate(g);
+  }
+
+  Graph g;
+  auto reader = g.register_process(make_read_bw64("reader", path, 1000));
+  auto sink = g.add_process<InterleavedStreamingAudioSink>("sink");
+  g.connect(reader->get_out_port("out_samples"), sink->get_in_port("in_samples"));
+  evaluate(g);
+
+  auto &read = sink->get();
+  REQUIRE(read.size() == samples.size());
+  REQUIRE(sink->get_block().info().sample_rate == 48000);
+
+  if (format == SampleFormat::Float32) {
+    REQUIRE(read == samples);
+  } else {
+    float scale = format == SampleFormat::Int16 ? 32768.0f : format == SampleFormat::Int24 ? 8388608.0f : 2147483648.0f;
+    for (size_t i = 0; i < samples.size(); i++) {
+      float expected = std::min(std::max(samples[i], -1.0f), 1.0f);
+      REQUIRE(std::abs(read[i] - expected) <= 1.0f / scale + 1e-7f);
+    }
+  }
+}
+
+TEST_CASE("write_bw64 passthrough") {
+  // samples going straight from read_bw64 to write_bw64 should be copied
+  // without decoding if the formats match, and converted otherwise
+  const auto in_format = GENERATE(SampleFormat::Int16, SampleFormat::Float32);
+  const auto out_format = GENERATE(SampleFormat::Int16, SampleFormat::Float32);
+  const size_t channels = 2;
+
+  // representable in all formats, so that all combinations are lossless
+  std::vector<float> samples(channels * 3001);
+  for (size_t i = 0; i < samples.size(); i++) samples[i] = static_cast<float>(i % 4001) / 2048.0f - 1.0f;
+
+  TempDir dir;
+  auto in_path = (dir / "in.wav").string();
+  auto out_path = (dir / "out.wav").string();
+  {
+    Graph g;
+    auto source =
+        g.add_process<InterleavedStreamingAudioSource>("source", samples, BlockDescription{1000, channels, 48000});
+    auto writer = g.register_process(make_write_bw64("writer", in_path, 0, in_format));
+    g.connect(source->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+    evaluate(g);
+  }
+
+  {
+    Graph g;
+    auto reader = g.register_process(make_read_bw64("reader", in_path, 1000));
+    auto writer = g.register_process(make_write_bw64("writer", out_path, 0, out_format));
+    g.connect(reader->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+
+    Plan p = plan(g);
+    bool found_reader = false;
+    for (auto &process : p.graph().get_processes())
+      if (process == reader) found_reader = true;
+    REQUIRE(found_reader == (in_format != out_format));
+
+    p.run();
+  }
+
+  REQUIRE(read_samples(out_path) == samples);
+}
+
+TEST_CASE("write_bw64 over its input") {
+  // the input is mapped while it is read, so truncating it to write the
+  // output must be refused rather than invalidating the mapping
+  const auto out_format = GENERATE(SampleFormat::Int16, SampleFormat::Float32);
+  const size_t channels = 2;
+
+  std::vector<float> samples(channels * 3001);
+  for (size_t i = 0; i < samples.size(); i++) samples[i] = static_cast<float>(i % 4001) / 2048.0f - 1.0f;
+
+  TempDir dir;
+  auto path = (dir / "in.wav").string();
+  {
+    Graph g;
+    auto source =
+        g.add_process<InterleavedStreamingAudioSource>("source", samples, BlockDescription{1000, channels, 48000});
+    auto writer = g.register_process(make_write_bw64("writer", path, 0, SampleFormat::Int16));
+    g.connect(source->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+    evaluate(g);
+  }
+
+  {
+    Graph g;
+    auto reader = g.register_process(make_read_bw64("reader", path, 1000));
+    auto writer = g.register_process(make_write_bw64("writer", path, 0, out_format));
+    g.connect(reader->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+    REQUIRE_THROWS_AS(evaluate(g), std::runtime_error);
+  }
+
+  // the input was not modified
+  REQUIRE(read_samples(path) == samples);
+}
+
+/// write a float WAV file with a 16-byte fmt chunk and no other chunks, so
+/// that the samples are aligned, and MappedWavReader returns views of them
+static void write_aligned_float_wav(const std::string &path, const std::vector<float> &samples, size_t channels) {
+  std::ofstream file(path, std::ios::binary);
+  auto put = [&](uint32_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) file.put(static_cast<char>(value >> (8 * i)));
+  };
+  auto data_size = static_cast<uint32_t>(samples.size() * 4);
+
+  file.write("RIFF", 4);
+  put(36 + data_size, 4);
+  file.write("WAVEfmt ", 8);
+  put(16, 4);
+  put(3, 2);  // WAVE_FORMAT_IEEE_FLOAT
+  put(static_cast<uint32_t>(channels), 2);
+  put(48000, 4);
+  put(static_cast<uint32_t>(48000 * channels * 4), 4);
+  put(static_cast<uint32_t>(channels * 4), 2);
+  put(32, 2);
+  file.write("data", 4);
+  put(data_size, 4);
+  for (float sample : samples) put(std::bit_cast<uint32_t>(sample), 4);
+}
+
+TEST_CASE("mapped views are copied before modification") {
+  const size_t channels = 2;
+  std::vector<float> samples(channels * 1000);
+  for (size_t i = 0; i < samples.size(); i++) samples[i] = static_cast<float>(i) / 2048.0f - 1.0f;
+
+  TempDir dir;
+  auto path = (dir / "in.wav").string();
+  write_aligned_float_wav(path, samples, channels);
+
+  auto reader = MappedWavReader::open(path);
+  REQUIRE(reader);
+
+  // through ValuePtr, an unshared view is copied rather than moved
+  {
+    auto block = reader->read(1000);
+    REQUIRE(block->is_view());
+    InterleavedBlockPtr ptr(std::move(block));
+
+    auto writable = ptr.move_or_copy();
+    REQUIRE(!writable->is_view());
+    writable->data()[0] = 5.0f;
+    REQUIRE(ptr.read()->data()[0] == samples[0]);
+  }
+
+  // non-const access to a view copies it
+  {
+    reader->seek(0);
+    auto block = reader->read(1000);
+    REQUIRE(block->is_view());
+    const float *view_data = std::as_const(*block).data();
+
+    block->sample(1, 0) = 6.0f;
+    REQUIRE(!block->is_view());
+    REQUIRE(block->data() != view_data);
+    REQUIRE(view_data[1] == samples[1]);
+  }
+
+  // neither reached the mapping or the file
+  reader->seek(0);
+  auto block = reader->read(1000);
+  REQUIRE(std::equal(samples.begin(), samples.end(), std::as_const(*block).data()));
+  REQUIRE(read_samples(path) == samples);
+}
+
+TEST_CASE("read_bw64 channels") {
+  const auto format = GENERATE(SampleFormat::Int16, SampleFormat::Float32);
+  const size_t channels = 5;
+  const std::vector<size_t> selected = {3, 1, 2, 1};
+
+  std::vector<float> samples(channels * 3001);
+  for (size_t i = 0; i < samples.size(); i++) samples[i] = static_cast<float>(i % 4001) / 2048.0f - 1.0f;
+
+  TempDir dir;
+  auto in_path = (dir / "in.wav").string();
+  auto out_path = (dir / "out.wav").string();
+  {
+    Graph g;
+    auto source =
+        g.add_process<InterleavedStreamingAudioSource>("source", samples, BlockDescription{1000, channels, 48000});
+    auto writer = g.register_process(make_write_bw64("writer", in_path, 0, format));
+    g.connect(source->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+    evaluate(g);
+  }
+
+  std::vector<float> expected;
+  for (size_t frame = 0; frame < samples.size() / channels; frame++)
+    for (size_t channel : selected) expected.push_back(samples[frame * channels + channel]);
+
+  {
+    Graph g;
+    auto reader = g.register_process(make_read_bw64("reader", in_path, 1000, 0, selected));
+    auto writer = g.register_process(make_write_bw64("writer", out_path, 0, format));
+    g.connect(reader->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+
+    // not all samples are used, so they can not be copied directly
+    Plan p = plan(g);
+    bool found_reader = false;
+    for (auto &process : p.graph().get_processes())
+      if (process == reader) found_reader = true;
+    REQUIRE(found_reader);
+
+    p.run();
+  }
+
+  REQUIRE(read_samples(out_path) == expected);
+
+  {
+    Graph g;
+    auto reader = g.register_process(make_read_bw64("reader", in_path, 1000, 0, {5}));
+    auto sink = g.add_process<InterleavedStreamingAudioSink>("sink");
+    g.connect(reader->get_out_port("out_samples"), sink->get_in_port("in_samples"));
+    REQUIRE_THROWS_AS(evaluate(g), std::runtime_error);
+  }
+}
+
+TEST_CASE("read_bw64 time range") {
+  // with the same format the range is copied directly, otherwise it is
+  // decoded and converted
+  const auto out_format = GENERATE(SampleFormat::Int16, SampleFormat::Float32);
+  const size_t channels = 2;
+  const unsigned int sample_rate = 1000;
+
+  std::vector<float> samples(channels * 3001);
+  for (size_t i = 0; i < samples.size(); i++) samples[i] = static_cast<float>(i % 4001) / 2048.0f - 1.0f;
+
+  TempDir dir;
+  auto in_path = (dir / "in.wav").string();
+  auto out_path = (dir / "out.wav").string();
+  {
+    Graph g;
+    auto source = g.add_process<InterleavedStreamingAudioSource>("source", samples,
+                                                                 BlockDescription{1000, channels, sample_rate});
+    auto writer = g.register_process(make_write_bw64("writer", in_path, 0, SampleFormat::Int16));
+    g.connect(source->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+    evaluate(g);
+  }
+
+  auto copy_range = [&](const TimeRange &range) {
+    Graph g;
+    auto reader = g.register_process(make_read_bw64("reader", in_path, 256, 0, {}, range));
+    auto writer = g.register_process(make_write_bw64("writer", out_path, 0, out_format));
+    g.connect(reader->get_out_port("out_samples"), writer->get_in_port("in_samples"));
+    evaluate(g);
+    return read_samples(out_path);
+  };
+
+  auto frames = [&](size_t start, size_t end) {
+    return std::vector<float>(samples.begin() + static_cast<std::ptrdiff_t>(start * channels),
+                              samples.begin() + static_cast<std::ptrdiff_t>(end * channels));
+  };
+
+  REQUIRE(copy_range({0.5, 1.2}) == frames(500, 1700));
+  REQUIRE(copy_range({2.5, std::nullopt}) == frames(2500, 3001));
+  REQUIRE(copy_range({2.5, 10.0}) == frames(2500, 3001));
+}
+
+TEST_CASE("read_adm_bw64 channels") {
+  TempDir dir;
+  auto path = (dir / "in.wav").string();
+
+  {
+    auto file = bw64::writeFile(path, 2, 48000, 24);
+    std::vector<float> samples = {0.1f, 0.2f, 0.3f, 0.4f};
+    file->write(samples.data(), 2);
+
+    auto document = adm::getCommonDefinitions();
+    auto object = AudioObject::create(AudioObjectName("object"));
+    document->add(object);
+    std::vector<std::string> track_uids = {"ATU_00000001", "ATU_00000002"};
+    std::vector<std::string> tracks = {"AT_00010001_01", "AT_00010002_01"};
+    for (size_t i = 0; i < 2; i++) {
+      auto track = AudioTrackUid::create(parseAudioTrackUidId(track_uids[i]));
+      track->setReference(document->lookup(parseAudioTrackFormatId(tracks[i])));
+      track->setReference(document->lookup(parseAudioPackFormatId("AP_00010002")));
+      document->add(track);
+      object->addReference(track);
+    }
+
+    std::ostringstream stream;
+    adm::writeXml(stream, document);
+    file->setAxmlChunk(std::make_shared<bw64::AxmlChunk>(stream.str()));
+
+    auto chna = std::make_shared<bw64::ChnaChunk>();
+    chna->addAudioId({1, "ATU_00000001", "AT_00010001_01", "AP_00010002"});
+    chna->addAudioId({2, "ATU_00000002", "AT_00010002_01", "AP_00010002"});
+    file->setChnaChunk(chna);
+  }
+
+  Graph g;
+  auto reader = g.register_process(make_read_adm_bw64("reader", path, 1024, 0, {1}));
+  auto samples_sink = g.add_process<InterleavedStreamingAudioSink>("samples_sink");
+  auto adm_sink = g.add_process<DataSink<ADMData>>("adm_sink");
+  g.connect(reader->get_out_port("out_samples"), samples_sink->get_in_port("in_samples"));
+  g.connect(reader->get_out_port("out_axml"), adm_sink->get_in_port("in"));
+  evaluate(g);
+
+  auto samples = samples_sink->get();
+  REQUIRE(samples.size() == 2);
+  REQUIRE(std::abs(samples[0] - 0.2f) < 1e-6f);
+  REQUIRE(std::abs(samples[1] - 0.4f) < 1e-6f);
+
+  auto &adm = adm_sink->get_value();
+  REQUIRE(adm.channel_map == channel_map_t{{parseAudioTrackUidId("ATU_00000002"), 0}});
+  REQUIRE(!adm.document.read()->lookup(parseAudioTrackUidId("ATU_00000001")));
+  REQUIRE(adm.document.read()->lookup(parseAudioTrackUidId("ATU_00000002")));
 }
 
 template <typename T>
@@ -99,11 +514,109 @@ bool writer_specialised() {
 }
 
 TEST_CASE("check MakeBuffer for block") {
-  // check that buffer readers and writers are specialised for InterleavedBlockPtr
+  // check that buffer readers and writers are specialised for InterleavedBlockPtr and PlanarBlockPtr
   REQUIRE(reader_specialised<InterleavedBlockPtr>());
   REQUIRE(writer_specialised<InterleavedBlockPtr>());
+  REQUIRE(reader_specialised<PlanarBlockPtr>());
+  REQUIRE(writer_specialised<PlanarBlockPtr>());
 
   // check that the above test actually works
   REQUIRE(!reader_specialised<int>());
   REQUIRE(!writer_specialised<int>());
 }
+
+TEST_CASE("MakeBuffer for block round trip") {
+  // samples which would not survive conversion to integer formats
+  const size_t n_channels = 3;
+  const size_t n_frames = GENERATE(0, 10, 2500);
+  std::vector<float> samples(n_channels * n_frames);
+  for (size_t i = 0; i < samples.size(); i++) samples[i] = static_cast<float>(i) * 1e-6f - 1.5f;
+
+  // no memory, enough for one 1000 frame block, or enough for everything
+  const size_t budget_bytes = GENERATE(0, 15000, 1000000);
+  auto memory_budget = std::make_shared<MemoryBudget>(budget_bytes);
+
+  Graph g;
+  auto source = g.add_process<InterleavedStreamingAudioSource>("source", samples,
+                                                               BlockDescription{1000, n_channels, 44100});
+  auto writer = g.register_process(MakeBuffer<InterleavedBlockPtr>::get_buffer_writer("writer", memory_budget));
+  auto reader = g.register_process(MakeBuffer<InterleavedBlockPtr>::get_buffer_reader("reader"));
+  auto sink = g.add_process<InterleavedStreamingAudioSink>("sink");
+
+  g.connect(source->get_out_port("out_samples"), writer->get_in_port("in"));
+  g.connect(writer->get_out_port("out"), reader->get_in_port("in"));
+  g.connect(reader->get_out_port("out"), sink->get_in_port("in_samples"));
+
+  Plan p = plan(g);
+  p.run();
+
+  REQUIRE(sink->get() == samples);
+  if (n_frames) {
+    auto block = sink->get_block();
+    REQUIRE(block.info().channel_count == n_channels);
+    REQUIRE(block.info().sample_rate == 44100);
+  }
+
+  // memory is given back once the samples have been read
+  REQUIRE(memory_budget->available() == budget_bytes);
+}
+
+TEST_CASE("planar block conversion") {
+  // sizes around the 4x4 tiles used for transposing
+  const size_t n_channels = GENERATE(1, 2, 4, 5, 9);
+  const size_t n_frames = GENERATE(0, 1, 3, 4, 17);
+
+  InterleavedSampleBlock interleaved{BlockDescription{n_frames, n_channels, 48000}};
+  for (size_t channel = 0; channel < n_channels; channel++)
+    for (size_t frame = 0; frame < n_frames; frame++)
+      interleaved.sample(channel, frame) = static_cast<float>(channel * 1000 + frame);
+
+  PlanarSampleBlock planar = to_planar(interleaved);
+  REQUIRE(planar.info().sample_count == n_frames);
+  REQUIRE(planar.info().channel_count == n_channels);
+  REQUIRE(planar.info().sample_rate == 48000);
+  for (size_t channel = 0; channel < n_channels; channel++)
+    for (size_t frame = 0; frame < n_frames; frame++)
+      REQUIRE(planar.sample(channel, frame) == interleaved.sample(channel, frame));
+
+  InterleavedSampleBlock round_trip = to_interleaved(planar);
+  REQUIRE(round_trip.info().sample_count == n_frames);
+  REQUIRE(round_trip.info().channel_count == n_channels);
+  REQUIRE(std::equal(round_trip.data(), round_trip.data() + n_frames * n_channels, interleaved.data()));
+}
+
+TEST_CASE("MakeBuffer for planar block round trip") {
+  const size_t n_channels = 3;
+  const size_t n_frames = GENERATE(0, 10, 2500);
+  std::vector<float> samples(n_channels * n_frames);
+  for (size_t i = 0; i < samples.size(); i++) samples[i] = static_cast<float>(i) * 1e-6f - 1.5f;
+
+  const size_t budget_bytes = GENERATE(0, 15000, 1000000);
+  auto memory_budget = std::make_shared<MemoryBudget>(budget_bytes);
+
+  // the interleaved source and sink are connected to the planar buffer, so
+  // the planner inserts conversions
+  Graph g;
+  auto source = g.add_process<InterleavedStreamingAudioSource>("source", samples,
+                                                               BlockDescription{1000, n_channels, 44100});
+  auto writer = g.register_process(MakeBuffer<PlanarBlockPtr>::get_buffer_writer("writer", memory_budget));
+  auto reader = g.register_process(MakeBuffer<PlanarBlockPtr>::get_buffer_reader("reader"));
+  auto sink = g.add_process<InterleavedStreamingAudioSink>("sink");
+
+  g.connect(source->get_out_port("out_samples"), writer->get_in_port("in"));
+  g.connect(writer->get_out_port("out"), reader->get_in_port("in"));
+  g.connect(reader->get_out_port("out"), sink->get_in_port("in_samples"));
+
+  Plan p = plan(g);
+  REQUIRE(p.graph().get_processes().size() == 6);
+  p.run();
+
+  REQUIRE(sink->get() == samples);
+  if (n_frames) {
+    auto block = sink->get_block();
+    REQUIRE(block.info().channel_count == n_channels);
+    REQUIRE(block.info().sample_rate == 44100);
+  }
+
+  REQUIRE(memory_budget->available() == budget_bytes);
+}
@@ -0,0 +1,76 @@
+#include "eat/process/block.hpp"
+
+#include <algorithm>
+#include <bw64/bw64.hpp>
+#include <filesystem>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../utilities/synthetic.hpp"
+#include "eat/framework/evaluate.hpp"
+#include "eat/process/temp_dir.hpp"
+
+using namespace eat::framework;
+using namespace eat::process;
+using namespace eat::utilities;
+
+TEST_CASE("bench temporary sample buffer") {
+  const size_t n_channels = 16;
+  const unsigned int sample_rate = 48000;
+  const size_t n_frames = 10 * sample_rate;
+
+  auto samples = make_synthetic_samples(n_channels, n_frames);
+
+  // the writer and reader which are used when the planner needs to buffer
+  // samples between subgraphs
+  BENCHMARK_ADVANCED("buffer writer and reader 16 channels 10s")(Catch::Benchmark::Chronometer meter) {
+    measure_run(meter, [&]() {
+      Graph g;
+      auto source = g.add_process<InterleavedStreamingAudioSource>(
+          "source", samples, BlockDescription{1024, n_channels, sample_rate});
+      auto writer = g.register_process(MakeBuffer<InterleavedBlockPtr>::get_buffer_writer("writer"));
+      auto reader = g.register_process(MakeBuffer<InterleavedBlockPtr>::get_buffer_reader("reader"));
+      auto sink = g.add_process<DiscardSamples>("sink");
+
+      g.connect(source->get_out_port("out_samples"), writer->get_in_port("in"));
+      g.connect(writer->get_out_port("out"), reader->get_in_port("in"));
+      g.connect(reader->get_out_port("out"), sink->get_in_port("in_samples"));
+      return g;
+    });
+  };
+
+  // for comparison, the 24 bit wav file previously used for buffering, with
+  // the same block size
+  BENCHMARK_ADVANCED("24 bit wav write and read 16 channels 10s")(Catch::Benchmark::Chronometer meter) {
+    TempDir dir;
+    meter.measure([&]() {
+      auto path = dir.get_temp_file("wav").string();
+      {
+        auto file = bw64::writeFile(path, static_cast<uint16_t>(n_channels), sample_rate, 24);
+        for (size_t pos = 0; pos < n_frames; pos += 1024)
+          file->write(samples.data() + pos * n_channels, std::min<size_t>(1024, n_frames - pos));
+      }
+
+      auto file = bw64::readFile(path);
+      std::vector<float> buffer(1024 * n_channels);
+      size_t frames_read = 0;
+      while (size_t n = file->read(buffer.data(), 1024)) frames_read += n;
+
+      file.reset();
+      std::filesystem::remove(path);
+      return frames_read;
+    });
+  };
+}
+
+TEST_CASE("bench planar block conversion") {
+  const size_t n_channels = 16;
+  const size_t block_size = 1024;
+
+  auto samples = make_synthetic_samples(n_channels, block_size);
+  InterleavedSampleBlock interleaved{samples, BlockDescription{block_size, n_channels, 48000}};
+  PlanarSampleBlock planar = to_planar(interleaved);
+
+  BENCHMARK("to_planar 16 channels 1024") { return to_planar(interleaved); };
+  BENCHMARK("to_interleaved 16 channels 1024") { return to_interleaved(planar); };
+}
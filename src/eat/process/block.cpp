@@ -1,13 +1,109 @@
 #include "eat/process/block.hpp"
 
-#include <bw64/bw64.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
 
 #include "eat/framework/process.hpp"
 #include "eat/process/temp_dir.hpp"
+#include "block_queue.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EAT_BLOCK_SSE2
+#endif
 
 using namespace eat::framework;
 using namespace eat::process;
 
+namespace {
+
+/// transpose a matrix of rows * cols samples in row-major order from in into
+/// out, so that in[r * cols + c] is copied to out[c * rows + r]
+///
+/// this is done in 4x4 tiles where SSE2 is available
+void transpose(float *out, const float *in, size_t rows, size_t cols) {
+  size_t row = 0;
+#ifdef EAT_BLOCK_SSE2
+  for (; row + 4 <= rows; row += 4) {
+    const float *in_rows = in + row * cols;
+    size_t col = 0;
+    for (; col + 4 <= cols; col += 4) {
+      __m128 r0 = _mm_loadu_ps(in_rows + col);
+      __m128 r1 = _mm_loadu_ps(in_rows + cols + col);
+      __m128 r2 = _mm_loadu_ps(in_rows + 2 * cols + col);
+      __m128 r3 = _mm_loadu_ps(in_rows + 3 * cols + col);
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+      _mm_storeu_ps(out + col * rows + row, r0);
+      _mm_storeu_ps(out + (col + 1) * rows + row, r1);
+      _mm_storeu_ps(out + (col + 2) * rows + row, r2);
+      _mm_storeu_ps(out + (col + 3) * rows + row, r3);
+    }
+    for (; col < cols; col++)
+      for (size_t tile_row = row; tile_row < row + 4; tile_row++)
+        out[col * rows + tile_row] = in[tile_row * cols + col];
+  }
+#endif
+  for (; row < rows; row++)
+    for (size_t col = 0; col < cols; col++) out[col * rows + row] = in[row * cols + col];
+}
+
+/// convert a stream of blocks using a function which converts one block
+///
+/// this has no state, so can be duplicated to break streaming connections
+/// which pass through a conversion (see StreamingAtomicProcess::duplicate)
+template <typename From, typename To, To (*convert)(const From &)>
+class ConvertBlocks : public StreamingAtomicProcess {
+ public:
+  explicit ConvertBlocks(const std::string &name)
+      : StreamingAtomicProcess(name),
+        in_samples(add_in_port<StreamPort<ValuePtr<From>>>("in")),
+        out_samples(add_out_port<StreamPort<ValuePtr<To>>>("out")) {
+    in_samples->set_read_only();
+  }
+
+  void process() override {
+    while (in_samples->available()) {
+      auto block = in_samples->pop().read();
+      out_samples->push(std::make_shared<To>(convert(*block)));
+    }
+    if (in_samples->eof()) out_samples->close();
+  }
+
+  bool is_duplicable() const override { return true; }
+
+  StreamingAtomicProcessPtr duplicate(const std::string &name) const override {
+    return std::make_shared<ConvertBlocks>(name);
+  }
+
+ private:
+  StreamPortPtr<ValuePtr<From>> in_samples;
+  StreamPortPtr<ValuePtr<To>> out_samples;
+};
+
+using ConvertToPlanar = ConvertBlocks<InterleavedSampleBlock, PlanarSampleBlock, to_planar>;
+using ConvertToInterleaved = ConvertBlocks<PlanarSampleBlock, InterleavedSampleBlock, to_interleaved>;
+
+}  // namespace
+
+namespace eat::process {
+
+PlanarSampleBlock to_planar(const InterleavedSampleBlock &block) {
+  PlanarSampleBlock planar{block.info()};
+  transpose(planar.data(), block.data(), block.info().sample_count, block.info().channel_count);
+  return planar;
+}
+
+InterleavedSampleBlock to_interleaved(const PlanarSampleBlock &block) {
+  InterleavedSampleBlock interleaved{block.info()};
+  transpose(interleaved.data(), block.data(), block.info().channel_count, block.info().sample_count);
+  return interleaved;
+}
+
+}  // namespace eat::process
+
 // audio buffering implementation
 namespace {
 
@@ -25,99 +121,254 @@ class TempFile {
   std::string path_;
 };
 
-using TempFilePtr = std::shared_ptr<const TempFile>;
+/// a temporary file containing blocks of raw float32 samples in native byte
+/// order, in the layout of the blocks (interleaved or planar)
+struct TempSampleFile : public TempFile {
+  TempSampleFile() : TempFile("f32") {}
+
+  size_t n_frames = 0;
+  /// largest number of frames in a block written to the file
+  size_t max_block_size = 0;
+  /// number of frames in each block, for planar blocks, which must be read
+  /// back with the same sizes
+  std::vector<size_t> block_sizes;
+};
+
+template <typename Block>
+constexpr bool is_planar = std::is_same_v<Block, PlanarSampleBlock>;
+
+/// samples written by SampleBufferWriter
+///
+/// the first blocks are held in memory while they fit in the memory budget,
+/// and the rest are stored in a temporary file
+template <typename Block>
+struct SampleBuffer {
+  SampleBuffer() = default;
+  SampleBuffer(const SampleBuffer &) = delete;
+  SampleBuffer &operator=(const SampleBuffer &) = delete;
+
+  ~SampleBuffer() {
+    if (memory_budget) memory_budget->release(reserved_bytes);
+  }
+
+  size_t channel_count = 0;
+  unsigned int sample_rate = 0;
+  /// total number of frames, in memory and in the file
+  size_t n_frames = 0;
+
+  std::vector<ValuePtr<Block>> blocks;
+  MemoryBudgetPtr memory_budget;
+  /// bytes reserved from memory_budget for blocks
+  size_t reserved_bytes = 0;
+
+  /// samples after blocks, or null if all samples are in memory
+  std::unique_ptr<TempSampleFile> file;
+};
+
+template <typename Block>
+using SampleBufferPtr = std::shared_ptr<const SampleBuffer<Block>>;
 
-/// write samples to a temporary wav file and return the path
-class TempWavWriter : public StreamingAtomicProcess {
+/// size of the stdio buffer used for temporary files, so that reads and
+/// writes are made in large chunks regardless of the block size
+constexpr size_t temp_file_buffer_size = 1 << 20;
+
+struct FileCloser {
+  void operator()(std::FILE *file) const { std::fclose(file); }
+};
+using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+
+FilePtr open_temp_file(const std::string &path, const char *mode) {
+  FilePtr file{std::fopen(path.c_str(), mode)};
+  if (!file) throw std::runtime_error("could not open temporary file " + path);
+  std::setvbuf(file.get(), nullptr, _IOFBF, temp_file_buffer_size);
+  return file;
+}
+
+/// write samples to a SampleBuffer
+///
+/// blocks are kept in memory while they fit in memory_budget (which may be
+/// null, to always use a file); once a block does not fit, it and all later
+/// blocks are written to a temporary file as raw float32, so that they are
+/// read back exactly, and without any conversion. writes happen on a
+/// background thread, so that the streaming subgraph does not wait for them
+template <typename Block>
+class SampleBufferWriter : public StreamingAtomicProcess {
  public:
-  TempWavWriter(const std::string &name)
+  SampleBufferWriter(const std::string &name, MemoryBudgetPtr memory_budget_)
       : StreamingAtomicProcess(name),
-        in_samples(add_in_port<StreamPort<InterleavedBlockPtr>>("in")),
-        out_path(add_out_port<DataPort<TempFilePtr>>("out")) {}
+        memory_budget(std::move(memory_budget_)),
+        in_samples(add_in_port<StreamPort<ValuePtr<Block>>>("in")),
+        out_buffer(add_out_port<DataPort<SampleBufferPtr<Block>>>("out")) {
+    in_samples->set_read_only();
+  }
 
-  void initialise() override { file_path = std::make_shared<TempFile>("wav"); }
+  void initialise() override {
+    buffer = std::make_shared<SampleBuffer<Block>>();
+    buffer->memory_budget = memory_budget;
+    have_format = false;
+  }
 
   void process() override {
     while (in_samples->available()) {
-      auto samples = in_samples->pop().read();
+      auto item = in_samples->pop();
+      auto samples = item.read();
       auto &frame_info = samples->info();
 
-      if (!file) {
-        file = bw64::writeFile(file_path->path(), frame_info.channel_count, frame_info.sample_rate, 24);
+      if (!have_format) {
+        have_format = true;
+        buffer->channel_count = frame_info.channel_count;
+        buffer->sample_rate = frame_info.sample_rate;
+      } else {
+        always_assert(frame_info.channel_count == buffer->channel_count, "channel count changed mid-stream");
+        always_assert(frame_info.sample_rate == buffer->sample_rate, "sample rate changed mid-stream");
+      }
+
+      size_t n_samples = frame_info.sample_count * frame_info.channel_count;
+      buffer->n_frames += frame_info.sample_count;
+
+      if (!buffer->file && memory_budget && memory_budget->try_reserve(n_samples * sizeof(float))) {
+        buffer->reserved_bytes += n_samples * sizeof(float);
+        buffer->blocks.push_back(std::move(item));
+        continue;
       }
 
-      file->write(samples->data(), frame_info.sample_count);
+      if (!buffer->file) {
+        buffer->file = std::make_unique<TempSampleFile>();
+        file = open_temp_file(buffer->file->path(), "wb");
+        auto write = [this](std::vector<SamplesPtr> &batch) {
+          for (auto &block : batch) write_block(*block);
+        };
+        writer = std::make_unique<WriteBehind<SamplesPtr>>(write_behind_blocks, write);
+      }
+
+      buffer->file->n_frames += frame_info.sample_count;
+      buffer->file->max_block_size = std::max(buffer->file->max_block_size, frame_info.sample_count);
+      if constexpr (is_planar<Block>) buffer->file->block_sizes.push_back(frame_info.sample_count);
+
+      writer->push(std::move(samples));
     }
   }
 
   void finalise() override {
-    // make sure that in_path is consumed
-    if (!file) {
-      // if we write zero samples, the number of channels and FS do not matter
-      // as the reader will produce no blocks
-      file = bw64::writeFile(file_path->path(), 0, 48000, 24);
+    if (writer) {
+      writer->finish();
+      writer.reset();
     }
-
-    file.reset();
-    out_path->set_value(std::move(file_path));
+    if (file) {
+      if (std::fflush(file.get()) != 0)
+        throw std::runtime_error("error writing temporary file " + buffer->file->path());
+      file.reset();
+    }
+    out_buffer->set_value(std::move(buffer));
   }
 
  private:
-  StreamPortPtr<InterleavedBlockPtr> in_samples;
-  DataPortPtr<TempFilePtr> out_path;
+  using SamplesPtr = std::shared_ptr<const Block>;
+
+  /// maximum number of blocks waiting to be written
+  static constexpr size_t write_behind_blocks = 8;
+
+  /// called on the writer thread
+  void write_block(const Block &samples) {
+    size_t n_samples = samples.info().sample_count * samples.info().channel_count;
+    if (std::fwrite(samples.data(), sizeof(float), n_samples, file.get()) != n_samples)
+      throw std::runtime_error("error writing temporary file " + buffer->file->path());
+  }
+
+  MemoryBudgetPtr memory_budget;
+  StreamPortPtr<ValuePtr<Block>> in_samples;
+  DataPortPtr<SampleBufferPtr<Block>> out_buffer;
 
-  TempFilePtr file_path;
-  std::shared_ptr<bw64::Bw64Writer> file;
+  std::shared_ptr<SampleBuffer<Block>> buffer;
+  FilePtr file;
+  std::unique_ptr<WriteBehind<SamplesPtr>> writer;
+  bool have_format = false;
 };
 
-/// read samples from a temporary wav file given a path
-class TempWavReader : public StreamingAtomicProcess {
+/// read samples from a SampleBuffer written by SampleBufferWriter
+///
+/// blocks held in memory are passed on unchanged. interleaved blocks from the
+/// file have block_size frames, or if block_size is 0, the same size as the
+/// largest block written to the file, so that the buffer does not change the
+/// block size seen by the downstream processes. planar blocks from the file
+/// have the same sizes as when they were written
+template <typename Block>
+class SampleBufferReader : public StreamingAtomicProcess {
  public:
-  TempWavReader(const std::string &name, size_t block_size_)
+  SampleBufferReader(const std::string &name, size_t block_size_)
       : StreamingAtomicProcess(name),
         block_size(block_size_),
-        in_path(add_in_port<DataPort<TempFilePtr>>("in")),
-        out_samples(add_out_port<StreamPort<InterleavedBlockPtr>>("out")) {
-    always_assert(block_size > 0, "block size must be > 0");
-  }
+        in_buffer(add_in_port<DataPort<SampleBufferPtr<Block>>>("in")),
+        out_samples(add_out_port<StreamPort<ValuePtr<Block>>>("out")) {}
 
   void initialise() override {
-    file_path = std::move(in_path->get_value());
-    file = bw64::readFile(file_path->path());
+    buffer = std::move(in_buffer->get_value());
+    block_idx = 0;
+    frames_read = 0;
+    if (buffer->file) {
+      file = open_temp_file(buffer->file->path(), "rb");
+      file_frames_read = 0;
+      file_block_idx = 0;
+      frames_per_block = block_size ? block_size : buffer->file->max_block_size;
+    }
   }
 
   void process() override {
-    std::vector<float> buffer(block_size * file->channels());
-    size_t n_frames = file->read(buffer.data(), block_size);
+    if (block_idx < buffer->blocks.size()) {
+      auto &block = buffer->blocks[block_idx++];
+      frames_read += block.read()->info().sample_count;
+      out_samples->push(block);
+      return;
+    }
+
+    size_t n_frames = 0;
+    if (buffer->file) {
+      if constexpr (is_planar<Block>) {
+        auto &block_sizes = buffer->file->block_sizes;
+        if (file_block_idx < block_sizes.size()) n_frames = block_sizes[file_block_idx++];
+      } else
+        n_frames = std::min(frames_per_block, buffer->file->n_frames - file_frames_read);
+    }
 
     if (n_frames > 0) {
-      buffer.resize(n_frames * file->channels());
-      auto samples = std::make_shared<InterleavedSampleBlock>(
-          std::move(buffer), BlockDescription{n_frames, file->channels(), file->sampleRate()});
-      out_samples->push(std::move(samples));
+      size_t n_samples = n_frames * buffer->channel_count;
+      std::vector<float> samples(n_samples);
+      if (std::fread(samples.data(), sizeof(float), n_samples, file.get()) != n_samples)
+        throw std::runtime_error("error reading temporary file " + buffer->file->path());
+      file_frames_read += n_frames;
+      frames_read += n_frames;
+
+      out_samples->push(std::make_shared<Block>(
+          std::move(samples), BlockDescription{n_frames, buffer->channel_count, buffer->sample_rate}));
     } else
       out_samples->close();
   }
 
   void finalise() override {
     file.reset();
-    file_path.reset();
+    buffer.reset();
   }
 
   std::optional<float> get_progress() override {
-    if (file && file->numberOfFrames())
-      return static_cast<float>(file->tell()) / static_cast<float>(file->numberOfFrames());
+    if (buffer && buffer->n_frames)
+      return static_cast<float>(frames_read) / static_cast<float>(buffer->n_frames);
     else
       return std::nullopt;
   }
 
  private:
   size_t block_size;
-  DataPortPtr<TempFilePtr> in_path;
-  StreamPortPtr<InterleavedBlockPtr> out_samples;
+  DataPortPtr<SampleBufferPtr<Block>> in_buffer;
+  StreamPortPtr<ValuePtr<Block>> out_samples;
 
-  TempFilePtr file_path;
-  std::shared_ptr<bw64::Bw64Reader> file;
+  SampleBufferPtr<Block> buffer;
+  size_t block_idx = 0;
+  size_t frames_read = 0;
+
+  FilePtr file;
+  size_t file_frames_read = 0;
+  size_t file_block_idx = 0;
+  size_t frames_per_block = 0;
 };
 
 }  // namespace
@@ -126,12 +377,42 @@ namespace eat::framework {
 
 template <>
 ProcessPtr MakeBuffer<InterleavedBlockPtr>::get_buffer_reader(const std::string &name) {
-  return std::make_shared<TempWavReader>(name, 1024);
+  return std::make_shared<SampleBufferReader<InterleavedSampleBlock>>(name, 0);
 }
 
 template <>
-ProcessPtr MakeBuffer<InterleavedBlockPtr>::get_buffer_writer(const std::string &name) {
-  return std::make_shared<TempWavWriter>(name);
+ProcessPtr MakeBuffer<InterleavedBlockPtr>::get_buffer_writer(const std::string &name,
+                                                             const MemoryBudgetPtr &memory_budget) {
+  return std::make_shared<SampleBufferWriter<InterleavedSampleBlock>>(name, memory_budget);
+}
+
+template <>
+ProcessPtr MakeBuffer<PlanarBlockPtr>::get_buffer_reader(const std::string &name) {
+  return std::make_shared<SampleBufferReader<PlanarSampleBlock>>(name, 0);
+}
+
+template <>
+ProcessPtr MakeBuffer<PlanarBlockPtr>::get_buffer_writer(const std::string &name,
+                                                        const MemoryBudgetPtr &memory_budget) {
+  return std::make_shared<SampleBufferWriter<PlanarSampleBlock>>(name, memory_budget);
+}
+
+bool ConvertStream<InterleavedBlockPtr>::can_convert(const StreamPortBase &to) {
+  return dynamic_cast<const StreamPort<PlanarBlockPtr> *>(&to) != nullptr;
+}
+
+ProcessPtr ConvertStream<InterleavedBlockPtr>::get_converter(const std::string &name, const StreamPortBase &to) {
+  if (!can_convert(to)) return nullptr;
+  return std::make_shared<ConvertToPlanar>(name);
+}
+
+bool ConvertStream<PlanarBlockPtr>::can_convert(const StreamPortBase &to) {
+  return dynamic_cast<const StreamPort<InterleavedBlockPtr> *>(&to) != nullptr;
+}
+
+ProcessPtr ConvertStream<PlanarBlockPtr>::get_converter(const std::string &name, const StreamPortBase &to) {
+  if (!can_convert(to)) return nullptr;
+  return std::make_shared<ConvertToInterleaved>(name);
 }
 
 }  // namespace eat::framework
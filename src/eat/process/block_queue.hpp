@@ -0,0 +1,145 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eat::process {
+
+/// a bounded queue for passing items between a process and a background
+/// thread which reads or writes them
+///
+/// push() blocks while the queue is full, and pop() blocks while it is empty
+/// and has not been closed. cancel() wakes both sides, for shutting down early
+template <typename T>
+class BlockQueue {
+ public:
+  explicit BlockQueue(size_t capacity_) : capacity(capacity_ ? capacity_ : 1) {}
+
+  /// push value, waiting for space; returns false (without pushing) if
+  /// cancelled
+  bool push(T value) {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_full.wait(lock, [&] { return cancelled || items.size() < capacity; });
+    if (cancelled) return false;
+
+    items.push_back(std::move(value));
+    not_empty.notify_one();
+    return true;
+  }
+
+  /// pop into value, waiting for an item; returns false once the queue is
+  /// closed and empty, or if cancelled
+  bool pop(T &value) {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_empty.wait(lock, [&] { return cancelled || closed || !items.empty(); });
+    if (cancelled || items.empty()) return false;
+
+    value = std::move(items.front());
+    items.pop_front();
+    not_full.notify_one();
+    return true;
+  }
+
+  /// pop into value if an item is available without waiting
+  bool try_pop(T &value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (cancelled || items.empty()) return false;
+
+    value = std::move(items.front());
+    items.pop_front();
+    not_full.notify_one();
+    return true;
+  }
+
+  /// no more items will be pushed
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+    not_empty.notify_all();
+  }
+
+  /// stop waiting in push() and pop(), and discard remaining items
+  void cancel() {
+    std::lock_guard<std::mutex> lock(mutex);
+    cancelled = true;
+    items.clear();
+    not_full.notify_all();
+    not_empty.notify_all();
+  }
+
+ private:
+  size_t capacity;
+  std::mutex mutex;
+  std::condition_variable not_full;
+  std::condition_variable not_empty;
+  std::deque<T> items;
+  bool closed = false;
+  bool cancelled = false;
+};
+
+/// writes items on a background thread, with up to depth items waiting
+///
+/// write is called on the background thread with batches of one or more items
+/// which were waiting, so that small items can be combined into larger
+/// writes. if write throws, the exception is rethrown from the next call to
+/// push() or finish()
+template <typename T>
+class WriteBehind {
+ public:
+  using WriteFn = std::function<void(std::vector<T> &)>;
+
+  WriteBehind(size_t depth, WriteFn write_) : queue(depth), write(std::move(write_)) {
+    thread = std::thread([this, depth]() {
+      std::vector<T> batch;
+      T item;
+      try {
+        while (queue.pop(item)) {
+          batch.clear();
+          batch.push_back(std::move(item));
+          while (batch.size() < depth && queue.try_pop(item)) batch.push_back(std::move(item));
+          write(batch);
+        }
+      } catch (...) {
+        error = std::current_exception();
+        queue.cancel();
+      }
+    });
+  }
+
+  WriteBehind(const WriteBehind &) = delete;
+  WriteBehind &operator=(const WriteBehind &) = delete;
+
+  ~WriteBehind() {
+    if (thread.joinable()) {
+      queue.cancel();
+      thread.join();
+    }
+  }
+
+  /// queue item to be written, waiting if depth items are already waiting
+  void push(T item) {
+    if (!queue.push(std::move(item))) finish();
+  }
+
+  /// wait for all items to be written
+  void finish() {
+    if (thread.joinable()) {
+      queue.close();
+      thread.join();
+    }
+    if (error) std::rethrow_exception(error);
+  }
+
+ private:
+  BlockQueue<T> queue;
+  WriteFn write;
+  std::thread thread;
+  std::exception_ptr error;
+};
+
+}  // namespace eat::process
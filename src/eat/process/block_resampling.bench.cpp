@@ -0,0 +1,39 @@
+#include "eat/process/block_resampling.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+
+#include "../utilities/synthetic.hpp"
+#include "eat/framework/evaluate.hpp"
+#include "eat/framework/utility_processes.hpp"
+
+using namespace eat::framework;
+using namespace eat::process;
+using namespace eat::utilities;
+using namespace std::chrono_literals;
+
+TEST_CASE("bench block resampling") {
+  SyntheticADMOptions options;
+  options.n_objects = 64;
+  options.duration = 1min;
+  options.block_duration = 10ms;
+
+  ADMData adm = make_synthetic_adm(options);
+
+  BENCHMARK_ADVANCED("BlockResampler 64 objects 1min 10ms to 100ms")(Catch::Benchmark::Chronometer meter) {
+    measure_run(meter, [&]() {
+      Graph g;
+      // give each graph its own copy of the document, so that copying is not
+      // measured
+      ADMData adm_copy{adm.document.move_or_copy(), adm.channel_map};
+      auto source = g.add_process<DataSource<ADMData>>("source", std::move(adm_copy));
+      auto resampler = g.add_process<BlockResampler>("resampler", adm::Time{std::chrono::nanoseconds{100ms}});
+      auto sink = g.add_process<NullSink<ADMData>>("sink");
+
+      g.connect(source->get_out_port("out"), resampler->get_in_port("in_axml"));
+      g.connect(resampler->get_out_port("out_axml"), sink->get_in_port("in"));
+      return g;
+    });
+  };
+}
@@ -14,7 +14,9 @@ class ApplyChannelMapping : public StreamingAtomicProcess {
       : StreamingAtomicProcess(name),
         in_samples(add_in_port<StreamPort<InterleavedBlockPtr>>("in_samples")),
         out_samples(add_out_port<StreamPort<InterleavedBlockPtr>>("out_samples")),
-        in_channel_mapping(add_in_port<DataPort<ChannelMapping>>("in_channel_mapping")) {}
+        in_channel_mapping(add_in_port<DataPort<ChannelMapping>>("in_channel_mapping")) {
+    in_samples->set_read_only();
+  }
 
   void initialise() override { channel_mapping = std::move(in_channel_mapping->get_value()); }
   void process() override {
@@ -38,6 +40,12 @@ class ApplyChannelMapping : public StreamingAtomicProcess {
   }
   void finalise() override {}
 
+  bool is_duplicable() const override { return true; }
+
+  StreamingAtomicProcessPtr duplicate(const std::string &name) const override {
+    return std::make_shared<ApplyChannelMapping>(name);
+  }
+
  private:
   ChannelMapping channel_mapping;
   StreamPortPtr<InterleavedBlockPtr> in_samples;
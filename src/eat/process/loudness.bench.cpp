@@ -0,0 +1,38 @@
+#include "eat/process/loudness.hpp"
+
+#include <adm/elements/loudness_metadata.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <ear/bs2051.hpp>
+
+#include "../utilities/synthetic.hpp"
+#include "eat/framework/evaluate.hpp"
+#include "eat/framework/utility_processes.hpp"
+#include "eat/process/block.hpp"
+
+using namespace eat::framework;
+using namespace eat::process;
+using namespace eat::utilities;
+
+TEST_CASE("bench measure loudness") {
+  const unsigned int sample_rate = 48000;
+  const size_t n_frames = 10 * sample_rate;
+
+  auto layout = ear::getLayout("4+5+0");
+  size_t n_channels = layout.channels().size();
+  auto samples = make_synthetic_samples(n_channels, n_frames);
+
+  BENCHMARK_ADVANCED("measure_loudness 4+5+0 10s")(Catch::Benchmark::Chronometer meter) {
+    measure_run(meter, [&]() {
+      Graph g;
+      auto source = g.add_process<InterleavedStreamingAudioSource>(
+          "source", samples, BlockDescription{1024, n_channels, sample_rate});
+      auto measure = g.register_process(make_measure_loudness("measure", layout));
+      auto sink = g.add_process<NullSink<adm::LoudnessMetadata>>("sink");
+
+      g.connect(source->get_out_port("out_samples"), measure->get_in_port("in_samples"));
+      g.connect(measure->get_out_port("out_loudness"), sink->get_in_port("in"));
+      return g;
+    });
+  };
+}
@@ -58,6 +58,8 @@ class MeasureLoudness : public StreamingAtomicProcess {
         fs(48000),
         n_channels(layout.channels().size()),
         state(ebur128_init(n_channels, fs, EBUR128_MODE_I | EBUR128_MODE_LRA | EBUR128_MODE_TRUE_PEAK)) {
+    in_samples->set_read_only();
+
     auto channels = layout.channels();
     for (size_t i = 0; i < channels.size(); i++) {
       auto &libear_channel = channels.at(i);
@@ -161,7 +163,9 @@ class UpdateAllProgrammeLoudnesses : public DynamicSubgraph {
       : DynamicSubgraph(name),
         in_samples(add_in_port<StreamPort<InterleavedBlockPtr>>("in_samples")),
         in_axml(add_in_port<DataPort<ADMData>>("in_axml")),
-        out_axml(add_out_port<DataPort<ADMData>>("out_axml")) {}
+        out_axml(add_out_port<DataPort<ADMData>>("out_axml")) {
+    in_samples->set_read_only();
+  }
 
  protected:
   virtual GraphPtr build_subgraph() override {
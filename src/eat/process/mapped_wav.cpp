@@ -0,0 +1,375 @@
+#include "mapped_wav.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+#ifdef WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EAT_MAPPED_WAV_SSE2
+#endif
+
+namespace eat::process {
+
+namespace {
+
+/// paths of all open MappedFiles, so that writers can check that they are not
+/// about to truncate a file which is being read
+struct MappedPaths {
+  std::mutex mutex;
+  std::vector<std::filesystem::path> paths;
+};
+
+MappedPaths &mapped_paths() {
+  static MappedPaths instance;
+  return instance;
+}
+
+}  // namespace
+
+/// a read-only mapping of a whole file
+///
+/// this is shared rather than private, so that it does not count against
+/// the memory which the system can commit, and works with files larger than
+/// the available memory
+class MappedFile {
+ public:
+  /// map path, returning nullptr on failure
+  static std::shared_ptr<MappedFile> open(const std::string &path);
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile() {
+    {
+      auto &mapped = mapped_paths();
+      std::lock_guard<std::mutex> lock(mapped.mutex);
+      mapped.paths.erase(std::find(mapped.paths.begin(), mapped.paths.end(), path_));
+    }
+
+#ifdef WIN32
+    UnmapViewOfFile(data_);
+#else
+    munmap(data_, size_);
+#endif
+  }
+
+  const char *data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  MappedFile(const std::string &path, char *data, size_t size) : path_(path), data_(data), size_(size) {
+    auto &mapped = mapped_paths();
+    std::lock_guard<std::mutex> lock(mapped.mutex);
+    mapped.paths.push_back(path_);
+  }
+
+  std::filesystem::path path_;
+  char *data_;
+  size_t size_;
+};
+
+#ifdef WIN32
+std::shared_ptr<MappedFile> MappedFile::open(const std::string &path) {
+  HANDLE file = CreateFileW(std::filesystem::path(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return nullptr;
+  }
+
+  HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping) return nullptr;
+
+  void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!data) return nullptr;
+
+  return std::shared_ptr<MappedFile>(
+      new MappedFile(path, static_cast<char *>(data), static_cast<size_t>(size.QuadPart)));
+}
+#else
+std::shared_ptr<MappedFile> MappedFile::open(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return nullptr;
+  }
+  size_t size = static_cast<size_t>(st.st_size);
+
+  void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return nullptr;
+
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  return std::shared_ptr<MappedFile>(new MappedFile(path, static_cast<char *>(data), size));
+}
+#endif
+
+namespace {
+
+constexpr uint16_t format_pcm = 1;
+constexpr uint16_t format_float = 3;
+constexpr uint16_t format_extensible = 0xFFFE;
+
+uint16_t read_u16(const unsigned char *p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+uint32_t read_u32(const unsigned char *p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t read_u64(const unsigned char *p) {
+  return static_cast<uint64_t>(read_u32(p)) | (static_cast<uint64_t>(read_u32(p + 4)) << 32);
+}
+
+bool id_is(const unsigned char *p, const char *id) { return std::memcmp(p, id, 4) == 0; }
+
+// conversion kernels. the integer conversions are not vectorised by the
+// compiler (int24 needs a byte shuffle), so SSE2 is used directly where
+// available, with scalar code for other platforms and for the samples at the
+// end; both give the same output, as all steps are exact or correctly rounded
+
+#ifdef EAT_MAPPED_WAV_SSE2
+/// convert 4 32-bit integers to floats, and scale them
+void store_scaled_4(float *out, __m128i values, float scale) {
+  _mm_storeu_ps(out, _mm_mul_ps(_mm_cvtepi32_ps(values), _mm_set1_ps(scale)));
+}
+#endif
+
+void convert_int16(const unsigned char *in, float *out, size_t n) {
+  size_t i = 0;
+#ifdef EAT_MAPPED_WAV_SSE2
+  for (; i + 8 <= n; i += 8) {
+    __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 2 * i));
+    // put each sample in the top half of a 32-bit lane, then shift down to
+    // sign-extend
+    store_scaled_4(out + i, _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16), 1.0f / 32768.0f);
+    store_scaled_4(out + i + 4, _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16), 1.0f / 32768.0f);
+  }
+#endif
+  for (; i < n; i++) {
+    auto value = static_cast<int16_t>(read_u16(in + 2 * i));
+    out[i] = static_cast<float>(value) * (1.0f / 32768.0f);
+  }
+}
+
+void convert_int24(const unsigned char *in, float *out, size_t n) {
+  size_t i = 0;
+#ifdef EAT_MAPPED_WAV_SSE2
+  // 4 samples are 12 bytes, but 16 are loaded, so stop while there are at
+  // least 2 more samples after these
+  for (; i + 6 <= n; i += 4) {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 3 * i));
+    // move sample j to the bottom of lane j, then shift it to the top 24 bits
+    // and back down to sign-extend
+    __m128i s01 = _mm_unpacklo_epi32(bytes, _mm_srli_si128(bytes, 3));
+    __m128i s23 = _mm_unpacklo_epi32(_mm_srli_si128(bytes, 6), _mm_srli_si128(bytes, 9));
+    __m128i values = _mm_srai_epi32(_mm_slli_epi32(_mm_unpacklo_epi64(s01, s23), 8), 8);
+    store_scaled_4(out + i, values, 1.0f / 8388608.0f);
+  }
+#endif
+  for (; i < n; i++) {
+    const unsigned char *p = in + 3 * i;
+    // put the sample in the top 24 bits, then shift down to sign-extend
+    auto value = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 8) | (static_cast<uint32_t>(p[1]) << 16) |
+                                      (static_cast<uint32_t>(p[2]) << 24)) >>
+                 8;
+    out[i] = static_cast<float>(value) * (1.0f / 8388608.0f);
+  }
+}
+
+void convert_int32(const unsigned char *in, float *out, size_t n) {
+  size_t i = 0;
+#ifdef EAT_MAPPED_WAV_SSE2
+  for (; i + 4 <= n; i += 4)
+    store_scaled_4(out + i, _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 4 * i)), 1.0f / 2147483648.0f);
+#endif
+  for (; i < n; i++) {
+    auto value = static_cast<int32_t>(read_u32(in + 4 * i));
+    out[i] = static_cast<float>(value) * (1.0f / 2147483648.0f);
+  }
+}
+
+void convert_float32(const unsigned char *in, float *out, size_t n) {
+  for (size_t i = 0; i < n; i++) out[i] = std::bit_cast<float>(read_u32(in + 4 * i));
+}
+
+}  // namespace
+
+std::unique_ptr<MappedWavReader> MappedWavReader::open(const std::string &path) {
+  auto file = MappedFile::open(path);
+  if (!file) return nullptr;
+
+  const auto *data = reinterpret_cast<const unsigned char *>(file->data());
+  size_t size = file->size();
+
+  if (size < 12 || !(id_is(data, "RIFF") || id_is(data, "RF64") || id_is(data, "BW64")) || !id_is(data + 8, "WAVE"))
+    return nullptr;
+
+  bool have_format = false;
+  bool have_data = false;
+  uint64_t ds64_data_size = 0;
+  uint16_t format_tag = 0, channels = 0, block_align = 0, bits_per_sample = 0;
+  uint32_t sample_rate = 0;
+  uint64_t data_offset = 0, data_size = 0;
+  std::vector<ChunkLocation> chunks;
+
+  // walk the chunks, which are padded to an even number of bytes
+  uint64_t pos = 12;
+  while (pos + 8 <= size) {
+    const unsigned char *header = data + pos;
+    uint64_t chunk_size = read_u32(header + 4);
+    uint64_t body = pos + 8;
+
+    if (id_is(header, "ds64") && chunk_size >= 16 && body + 16 <= size) {
+      ds64_data_size = read_u64(data + body + 8);
+    } else if (id_is(header, "fmt ") && chunk_size >= 16 && body + chunk_size <= size) {
+      const unsigned char *fmt = data + body;
+      format_tag = read_u16(fmt);
+      channels = read_u16(fmt + 2);
+      sample_rate = read_u32(fmt + 4);
+      block_align = read_u16(fmt + 12);
+      bits_per_sample = read_u16(fmt + 14);
+      // the sub-format GUID starts with the format tag
+      if (format_tag == format_extensible && chunk_size >= 40) format_tag = read_u16(fmt + 24);
+      have_format = true;
+    } else if (id_is(header, "data")) {
+      if (chunk_size == 0xFFFFFFFF) chunk_size = ds64_data_size;
+      data_offset = body;
+      // a file which was not finalised may be shorter than the header says
+      data_size = std::min<uint64_t>(chunk_size, size - body);
+      have_data = true;
+    } else if (body <= size) {
+      ChunkLocation location{{}, static_cast<size_t>(body), static_cast<size_t>(std::min(chunk_size, size - body))};
+      std::memcpy(location.id, header, 4);
+      chunks.push_back(location);
+    }
+
+    pos = body + chunk_size + (chunk_size & 1);
+  }
+
+  if (!have_format || !have_data || channels == 0) return nullptr;
+
+  bool supported = (format_tag == format_pcm && (bits_per_sample == 16 || bits_per_sample == 24 ||
+                                                 bits_per_sample == 32)) ||
+                   (format_tag == format_float && bits_per_sample == 32);
+  if (!supported || block_align != channels * (bits_per_sample / 8)) return nullptr;
+
+  std::unique_ptr<MappedWavReader> reader{new MappedWavReader};
+  reader->file = std::move(file);
+  reader->data_offset = static_cast<size_t>(data_offset);
+  reader->format_tag = format_tag;
+  reader->bits_per_sample = bits_per_sample;
+  reader->channels_ = channels;
+  reader->sample_rate_ = sample_rate;
+  reader->n_frames = static_cast<size_t>(data_size / block_align);
+  reader->chunks = std::move(chunks);
+  return reader;
+}
+
+MappedWavReader::~MappedWavReader() = default;
+
+bool MappedWavReader::is_mapped(const std::string &path) {
+  auto &mapped = mapped_paths();
+  std::lock_guard<std::mutex> lock(mapped.mutex);
+  for (auto &mapped_path : mapped.paths) {
+    std::error_code ec;
+    if (std::filesystem::equivalent(mapped_path, path, ec)) return true;
+  }
+  return false;
+}
+
+std::optional<std::string_view> MappedWavReader::chunk(const char *id) const {
+  for (auto &location : chunks)
+    if (std::memcmp(location.id, id, 4) == 0) return std::string_view{file->data() + location.offset, location.size};
+  return std::nullopt;
+}
+
+SampleFormat MappedWavReader::sample_format() const {
+  if (format_tag == format_float) return SampleFormat::Float32;
+  if (bits_per_sample == 16) return SampleFormat::Int16;
+  if (bits_per_sample == 24) return SampleFormat::Int24;
+  return SampleFormat::Int32;
+}
+
+std::shared_ptr<InterleavedSampleBlock> MappedWavReader::read(size_t max_frames, const std::vector<size_t> &channels) {
+  size_t frames = std::min(max_frames, n_frames - position);
+  if (!frames) return nullptr;
+
+  size_t sample_size = bits_per_sample / 8;
+  size_t frame_size = channels_ * sample_size;
+  const char *start = file->data() + data_offset + position * frame_size;
+  position += frames;
+
+  auto convert = [&](const unsigned char *in, float *out, size_t n) {
+    if (format_tag == format_float)
+      convert_float32(in, out, n);
+    else if (bits_per_sample == 16)
+      convert_int16(in, out, n);
+    else if (bits_per_sample == 24)
+      convert_int24(in, out, n);
+    else
+      convert_int32(in, out, n);
+  };
+
+  const auto *in = reinterpret_cast<const unsigned char *>(start);
+
+  if (!channels.empty()) {
+    // only the selected samples are touched; each run of adjacent channels
+    // is converted in one call
+    size_t n_out = channels.size();
+    std::vector<float> samples(frames * n_out);
+    for (size_t frame = 0; frame < frames; frame++) {
+      const unsigned char *frame_in = in + frame * frame_size;
+      float *frame_out = samples.data() + frame * n_out;
+      for (size_t i = 0; i < n_out;) {
+        size_t run = 1;
+        while (i + run < n_out && channels[i + run] == channels[i] + run) run++;
+        convert(frame_in + channels[i] * sample_size, frame_out + i, run);
+        i += run;
+      }
+    }
+
+    return std::make_shared<InterleavedSampleBlock>(std::move(samples),
+                                                    BlockDescription{frames, n_out, sample_rate_});
+  }
+
+  BlockDescription description{frames, channels_, sample_rate_};
+  size_t n = frames * channels_;
+
+  // view float samples in place if possible; the block holds a reference to
+  // the mapping to keep it alive, and copies the samples before they are
+  // modified
+  if (format_tag == format_float && std::endian::native == std::endian::little &&
+      reinterpret_cast<uintptr_t>(start) % alignof(float) == 0)
+    return std::make_shared<InterleavedSampleBlock>(file, reinterpret_cast<const float *>(start), description);
+
+  std::vector<float> samples(n);
+  convert(in, samples.data(), n);
+
+  return std::make_shared<InterleavedSampleBlock>(std::move(samples), description);
+}
+
+}  // namespace eat::process
@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "eat/process/adm_bw64.hpp"
+#include "eat/process/block.hpp"
+
+namespace eat::process {
+
+class MappedFile;
+
+/// reads samples from a WAV, RF64 or BW64 file through a memory mapping
+///
+/// blocks of 32-bit float samples are views of the mapping, so are not copied
+/// unless they are modified; 16, 24 and 32-bit integer samples are converted
+/// directly from the mapping. the mapping is read-only, and blocks which view
+/// it are copied before they are modified.
+///
+/// only the parts of the file which are being read need to be in memory, so
+/// this works with files larger than the available RAM
+class MappedWavReader {
+ public:
+  /// open path, returning nullptr if it could not be mapped or its format is
+  /// not supported, in which case another reader should be used
+  static std::unique_ptr<MappedWavReader> open(const std::string &path);
+
+  ~MappedWavReader();
+
+  /// is path the same file as one which is open in any MappedWavReader?
+  ///
+  /// writing to a file truncates it, which would invalidate the mapping, so
+  /// writers use this to refuse to write over a file which is being read
+  static bool is_mapped(const std::string &path);
+
+  size_t channels() const { return channels_; }
+  unsigned int sample_rate() const { return sample_rate_; }
+  size_t number_of_frames() const { return n_frames; }
+  /// number of frames read, or the frame seeked to
+  size_t tell() const { return position; }
+  /// move to frame, so that the next read() starts there; frames past the end
+  /// are clamped to the end
+  void seek(size_t frame) { position = std::min(frame, n_frames); }
+
+  /// format of the samples in the file
+  SampleFormat sample_format() const;
+  /// offset of the first sample in the file, in bytes
+  size_t samples_offset() const { return data_offset; }
+  /// size of one frame of samples, in bytes
+  size_t frame_size() const { return channels_ * (bits_per_sample / 8); }
+  /// size of all samples in the file, in bytes
+  size_t samples_size() const { return n_frames * frame_size(); }
+
+  /// read up to max_frames frames, returning nullptr at the end of the file
+  ///
+  /// if channels is not empty, the output only contains these channels (in
+  /// this order), and other channels are not decoded; all must be less than
+  /// channels()
+  std::shared_ptr<InterleavedSampleBlock> read(size_t max_frames, const std::vector<size_t> &channels = {});
+
+  /// the body of the first chunk with the given 4-character ID, as a view of
+  /// the mapping which is valid for the lifetime of this reader
+  std::optional<std::string_view> chunk(const char *id) const;
+
+ private:
+  MappedWavReader() = default;
+
+  std::shared_ptr<MappedFile> file;
+  /// offset of the first sample in file
+  size_t data_offset = 0;
+  uint16_t format_tag = 0;
+  uint16_t bits_per_sample = 0;
+  size_t channels_ = 0;
+  unsigned int sample_rate_ = 0;
+  size_t n_frames = 0;
+  size_t position = 0;
+
+  struct ChunkLocation {
+    char id[4];
+    size_t offset;
+    size_t size;
+  };
+  std::vector<ChunkLocation> chunks;
+};
+
+}  // namespace eat::process
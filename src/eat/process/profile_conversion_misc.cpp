@@ -274,6 +274,12 @@ class AddSilentTrack : public StreamingAtomicProcess {
     if (in_samples->eof()) out_samples->close();
   }
 
+  bool is_duplicable() const override { return true; }
+
+  StreamingAtomicProcessPtr duplicate(const std::string &name) const override {
+    return std::make_shared<AddSilentTrack>(name);
+  }
+
  private:
   StreamPortPtr<InterleavedBlockPtr> in_samples;
   StreamPortPtr<InterleavedBlockPtr> out_samples;
@@ -1,5 +1,6 @@
 #include "eat/process/temp_dir.hpp"
 
+#include <mutex>
 #include <random>
 
 #include "eat/framework/exceptions.hpp"
@@ -14,7 +15,7 @@ class TempDirImpl {
     auto base_path = std::filesystem::temp_directory_path();
 
     std::random_device rd;
-    random_engine = std::default_random_engine{rd()};
+    std::default_random_engine random_engine{rd()};
     std::uniform_int_distribution<int> dist(0, 100000);
 
     while (true) {
@@ -32,23 +33,25 @@ class TempDirImpl {
   }
 
   std::filesystem::path get_temp_file(const std::string &extension) {
-    std::uniform_int_distribution<int> dist(0, 100000);
-    while (true) {
-      int random = dist(random_engine);
-      // there's no clean way to make sure this is actually unique
-      auto file_path = path / (std::to_string(random) + "." + extension);
-      if (!std::filesystem::exists(file_path)) return file_path;
-    }
+    // this may be called from steps running in parallel; numbering the files
+    // makes the names unique without checking the directory, which this
+    // process created
+    std::lock_guard<std::mutex> lock(mutex);
+    return path / (std::to_string(next_file++) + "." + extension);
   }
 
  private:
-  std::default_random_engine random_engine;
+  std::mutex mutex;
   std::filesystem::path path;
+  /// number of the next file returned by get_temp_file
+  size_t next_file = 0;
 };
 
 TempDir::TempDir() {
+  static std::mutex instance_mutex;
   static std::shared_ptr<TempDirImpl> instance = {};
 
+  std::lock_guard<std::mutex> lock(instance_mutex);
   if (!instance) instance = std::make_shared<TempDirImpl>();
 
   impl = instance;
@@ -0,0 +1,27 @@
+#include "eat/process/validate.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "../utilities/synthetic.hpp"
+#include "eat/process/profiles.hpp"
+
+using namespace eat::process;
+using namespace eat::process::validation;
+using namespace eat::utilities;
+
+TEST_CASE("bench validate") {
+  SyntheticADMOptions options;
+  options.n_objects = GENERATE(16, 128);
+  options.n_direct_speakers = 1;
+  options.n_hoa = 1;
+  options.duration = std::chrono::minutes{1};
+
+  ADMData adm = make_synthetic_adm(options);
+  ProfileValidator validator = make_profile_validator(profiles::ITUEmissionProfile{0});
+
+  BENCHMARK("ProfileValidator::run emission profile " + std::to_string(options.n_objects) + " objects 1min") {
+    return validator.run(adm);
+  };
+}
@@ -0,0 +1,415 @@
+#include "wav_writer.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+
+#include "mapped_wav.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EAT_WAV_WRITER_SSE2
+#endif
+
+namespace eat::process {
+
+namespace {
+
+constexpr uint16_t format_pcm = 1;
+constexpr uint16_t format_float = 3;
+
+/// size of the stdio buffer; large writes bypass this
+constexpr size_t file_buffer_size = 1 << 20;
+
+/// size of a ds64 chunk with no table, which is reserved by a JUNK chunk
+constexpr uint32_t ds64_size = 28;
+/// offset of the JUNK/ds64 chunk header
+constexpr long ds64_offset = 12;
+/// offset of the fmt chunk header
+constexpr long fmt_offset = ds64_offset + 8 + ds64_size;
+
+void put_u16(unsigned char *p, uint16_t value) {
+  p[0] = static_cast<unsigned char>(value);
+  p[1] = static_cast<unsigned char>(value >> 8);
+}
+
+void put_u32(unsigned char *p, uint32_t value) {
+  for (size_t i = 0; i < 4; i++) p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+void put_u64(unsigned char *p, uint64_t value) {
+  for (size_t i = 0; i < 8; i++) p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+void put_id(unsigned char *p, const char *id) { std::memcpy(p, id, 4); }
+
+uint32_t id_value(const char *id) {
+  return static_cast<uint32_t>(static_cast<unsigned char>(id[0])) |
+         (static_cast<uint32_t>(static_cast<unsigned char>(id[1])) << 8) |
+         (static_cast<uint32_t>(static_cast<unsigned char>(id[2])) << 16) |
+         (static_cast<uint32_t>(static_cast<unsigned char>(id[3])) << 24);
+}
+
+/// seek to an absolute offset, which may be beyond the range of long
+bool seek_to(std::FILE *file, uint64_t offset) {
+#ifdef _WIN32
+  return _fseeki64(file, static_cast<__int64>(offset), SEEK_SET) == 0;
+#else
+  return fseeko(file, static_cast<off_t>(offset), SEEK_SET) == 0;
+#endif
+}
+
+/// an output streambuf which writes to a stdio file through a small buffer,
+/// counting the bytes written, so that chunks can be serialised directly to
+/// the file
+class FileStreambuf : public std::streambuf {
+ public:
+  explicit FileStreambuf(std::FILE *file_) : file(file_), buffer(1 << 16) { reset(); }
+
+  uint64_t count() const { return count_; }
+
+ protected:
+  int_type overflow(int_type c) override {
+    if (!flush()) return traits_type::eof();
+    if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+    return c;
+  }
+
+  int sync() override { return flush() ? 0 : -1; }
+
+ private:
+  bool flush() {
+    size_t n = static_cast<size_t>(pptr() - pbase());
+    bool ok = std::fwrite(pbase(), 1, n, file) == n;
+    count_ += n;
+    reset();
+    return ok;
+  }
+
+  void reset() { setp(buffer.data(), buffer.data() + buffer.size()); }
+
+  std::FILE *file;
+  std::vector<char> buffer;
+  uint64_t count_ = 0;
+};
+
+/// store value in little-endian order; this is a plain store on
+/// little-endian machines, which does not get in the way of vectorisation
+template <typename Int>
+void store_le(unsigned char *p, Int value) {
+  if constexpr (std::endian::native == std::endian::little)
+    std::memcpy(p, &value, sizeof(value));
+  else
+    for (size_t i = 0; i < sizeof(value); i++) p[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+size_t fmt_size(SampleFormat format) { return format == SampleFormat::Float32 ? 18 : 16; }
+
+size_t format_sample_size(SampleFormat format) {
+  switch (format) {
+    case SampleFormat::Int16:
+      return 2;
+    case SampleFormat::Int24:
+      return 3;
+    case SampleFormat::Int32:
+    case SampleFormat::Float32:
+      return 4;
+  }
+  throw std::invalid_argument("unknown sample format");
+}
+
+// conversion kernels. clipping stops gcc from vectorising simple loops
+// (without -fno-trapping-math), so SSE2 is used directly where available,
+// with scalar code for other platforms and for the samples at the end
+
+/// scale sample, clip to [-scale, max] and round to the nearest integer (with
+/// ties to even, as the SSE2 version does); NaN is clipped to -scale
+template <typename Int>
+Int quantise(float sample, float scale, float max) {
+  return static_cast<Int>(std::nearbyint(std::min(std::max(-scale, sample * scale), max)));
+}
+
+#ifdef EAT_WAV_WRITER_SSE2
+/// quantise 4 samples from in, like quantise()
+__m128i quantise_4(const float *in, float scale, float max) {
+  __m128 scaled = _mm_mul_ps(_mm_loadu_ps(in), _mm_set1_ps(scale));
+  // max returns the second operand if either is NaN
+  __m128 clipped = _mm_min_ps(_mm_max_ps(scaled, _mm_set1_ps(-scale)), _mm_set1_ps(max));
+  return _mm_cvtps_epi32(clipped);
+}
+#endif
+
+void convert_int16(const float *in, unsigned char *out, size_t n) {
+  size_t i = 0;
+#ifdef EAT_WAV_WRITER_SSE2
+  for (; i + 8 <= n; i += 8) {
+    __m128i low = quantise_4(in + i, 32768.0f, 32767.0f);
+    __m128i high = quantise_4(in + i + 4, 32768.0f, 32767.0f);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 2 * i), _mm_packs_epi32(low, high));
+  }
+#endif
+  for (; i < n; i++) store_le(out + 2 * i, static_cast<uint16_t>(quantise<int16_t>(in[i], 32768.0f, 32767.0f)));
+}
+
+void convert_int24(const float *in, unsigned char *out, size_t n) {
+  size_t i = 0;
+#ifdef EAT_WAV_WRITER_SSE2
+  alignas(16) int32_t values[4];
+  for (; i + 4 <= n; i += 4) {
+    _mm_store_si128(reinterpret_cast<__m128i *>(values), quantise_4(in + i, 8388608.0f, 8388607.0f));
+    for (size_t j = 0; j < 4; j++) std::memcpy(out + 3 * (i + j), &values[j], 3);
+  }
+#endif
+  for (; i < n; i++) {
+    auto value = static_cast<uint32_t>(quantise<int32_t>(in[i], 8388608.0f, 8388607.0f));
+    out[3 * i] = static_cast<unsigned char>(value);
+    out[3 * i + 1] = static_cast<unsigned char>(value >> 8);
+    out[3 * i + 2] = static_cast<unsigned char>(value >> 16);
+  }
+}
+
+void convert_int32(const float *in, unsigned char *out, size_t n) {
+  // 2^31 - 1 is not representable, so use the largest float below 2^31
+  size_t i = 0;
+#ifdef EAT_WAV_WRITER_SSE2
+  for (; i + 4 <= n; i += 4)
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + 4 * i), quantise_4(in + i, 2147483648.0f, 2147483520.0f));
+#endif
+  for (; i < n; i++)
+    store_le(out + 4 * i, static_cast<uint32_t>(quantise<int32_t>(in[i], 2147483648.0f, 2147483520.0f)));
+}
+
+void convert_float32(const float *in, unsigned char *out, size_t n) {
+  for (size_t i = 0; i < n; i++) store_le(out + 4 * i, std::bit_cast<uint32_t>(in[i]));
+}
+
+}  // namespace
+
+WavWriter::WavWriter(const std::string &path_, size_t channels, unsigned int sample_rate, SampleFormat format_)
+    : path(path_), channels_(channels), format(format_), sample_size(format_sample_size(format_)) {
+  if (MappedWavReader::is_mapped(path)) throw std::runtime_error("cannot write to " + path + " while it is being read");
+
+  file.reset(std::fopen(path.c_str(), "wb"));
+  if (!file) throw std::runtime_error("could not open " + path + " for writing");
+  std::setvbuf(file.get(), nullptr, _IOFBF, file_buffer_size);
+
+  // sizes are filled in by close()
+  size_t header_size = fmt_offset + 8 + fmt_size(format) + 8;
+  std::vector<unsigned char> header(header_size, 0);
+  unsigned char *p = header.data();
+
+  put_id(p, "RIFF");
+  put_id(p + 8, "WAVE");
+  put_id(p + ds64_offset, "JUNK");
+  put_u32(p + ds64_offset + 4, ds64_size);
+
+  unsigned char *fmt = p + fmt_offset;
+  put_id(fmt, "fmt ");
+  put_u32(fmt + 4, static_cast<uint32_t>(fmt_size(format)));
+  put_u16(fmt + 8, format == SampleFormat::Float32 ? format_float : format_pcm);
+  put_u16(fmt + 10, static_cast<uint16_t>(channels));
+  put_u32(fmt + 12, sample_rate);
+  put_u32(fmt + 16, static_cast<uint32_t>(sample_rate * channels * sample_size));
+  put_u16(fmt + 20, static_cast<uint16_t>(channels * sample_size));
+  put_u16(fmt + 22, static_cast<uint16_t>(8 * sample_size));
+  // cbSize for float is 0, from zero-initialisation
+
+  put_id(p + header_size - 8, "data");
+
+  write_bytes(header.data(), header.size());
+}
+
+WavWriter::~WavWriter() {
+  if (file) {
+    try {
+      close();
+    } catch (std::exception &) {
+    }
+  }
+}
+
+void WavWriter::write(const float *samples, size_t n_frames) {
+  size_t n = n_frames * channels_;
+  if (!n) return;
+
+  if (format == SampleFormat::Float32 && std::endian::native == std::endian::little) {
+    write_bytes(samples, n * sizeof(float));
+  } else {
+    buffer.resize(n * sample_size);
+    switch (format) {
+      case SampleFormat::Int16:
+        convert_int16(samples, buffer.data(), n);
+        break;
+      case SampleFormat::Int24:
+        convert_int24(samples, buffer.data(), n);
+        break;
+      case SampleFormat::Int32:
+        convert_int32(samples, buffer.data(), n);
+        break;
+      case SampleFormat::Float32:
+        convert_float32(samples, buffer.data(), n);
+        break;
+    }
+    write_bytes(buffer.data(), buffer.size());
+  }
+
+  data_size += n * sample_size;
+}
+
+void WavWriter::copy_samples(const std::string &source_path, uint64_t offset, uint64_t size) {
+  uint64_t copied = 0;
+
+#ifdef __linux__
+  // copy_file_range copies within the kernel, or shares the blocks between
+  // the files on filesystems which support this; if it fails (e.g. because
+  // the files are on different filesystems on older kernels), the rest is
+  // copied below
+  int in_fd = ::open(source_path.c_str(), O_RDONLY);
+  if (in_fd >= 0) {
+    if (std::fflush(file.get()) != 0) {
+      ::close(in_fd);
+      throw std::runtime_error("error writing " + path);
+    }
+
+    loff_t in_offset = static_cast<loff_t>(offset);
+    while (copied < size) {
+      ssize_t n = copy_file_range(in_fd, &in_offset, fileno(file.get()), nullptr, size - copied, 0);
+      if (n <= 0) break;
+      copied += static_cast<uint64_t>(n);
+    }
+    ::close(in_fd);
+
+    // the file position was moved without going through stdio
+    if (std::fseek(file.get(), 0, SEEK_END) != 0) throw std::runtime_error("error writing " + path);
+  }
+#endif
+
+  if (copied < size) {
+    std::ifstream in(source_path, std::ios::binary);
+    in.seekg(static_cast<std::streamoff>(offset + copied));
+    if (!in) throw std::runtime_error("could not read samples from " + source_path);
+
+    std::vector<char> chunk(file_buffer_size);
+    while (copied < size) {
+      size_t to_read = static_cast<size_t>(std::min<uint64_t>(chunk.size(), size - copied));
+      in.read(chunk.data(), static_cast<std::streamsize>(to_read));
+      size_t n = static_cast<size_t>(in.gcount());
+      if (!n) throw std::runtime_error("unexpected end of samples in " + source_path);
+
+      write_bytes(chunk.data(), n);
+      copied += n;
+    }
+  }
+
+  data_size += size;
+}
+
+void WavWriter::set_chunk(const char *id, ChunkWriter write) {
+  uint32_t id_v = id_value(id);
+  auto same_id = [&](const Chunk &other) { return other.id == id_v; };
+  chunks.erase(std::remove_if(chunks.begin(), chunks.end(), same_id), chunks.end());
+  chunks.push_back({id_v, std::move(write)});
+}
+
+void WavWriter::set_chunk(std::shared_ptr<bw64::Chunk> chunk) {
+  char id[4];
+  uint32_t id_v = chunk->id();
+  for (size_t i = 0; i < 4; i++) id[i] = static_cast<char>(id_v >> (8 * i));
+  set_chunk(id, [chunk](std::ostream &stream) { chunk->write(stream); });
+}
+
+void WavWriter::close() {
+  if (!file) throw std::logic_error("WavWriter already closed");
+
+  size_t data_header_offset = fmt_offset + 8 + fmt_size(format);
+
+  unsigned char zero = 0;
+  if (data_size & 1) write_bytes(&zero, 1);
+
+  // chunks are written straight to the file with a placeholder size, which
+  // is filled in below
+  struct ChunkSize {
+    uint64_t offset;
+    uint32_t size;
+  };
+  std::vector<ChunkSize> chunk_sizes;
+
+  uint64_t chunks_size = 0;
+  for (auto &chunk : chunks) {
+    uint64_t offset = data_header_offset + 8 + data_size + (data_size & 1) + chunks_size;
+
+    unsigned char header[8] = {};
+    put_u32(header, chunk.id);
+    write_bytes(header, sizeof(header));
+
+    FileStreambuf buf(file.get());
+    std::ostream stream(&buf);
+    chunk.write(stream);
+    stream.flush();
+    if (!stream) throw std::runtime_error("error writing " + path);
+
+    uint64_t size = buf.count();
+    if (size > 0xFFFFFFFF) throw std::runtime_error("chunk too large to write to " + path);
+    if (size & 1) write_bytes(&zero, 1);
+
+    chunk_sizes.push_back({offset + 4, static_cast<uint32_t>(size)});
+    chunks_size += 8 + size + (size & 1);
+  }
+
+  // everything after the RIFF size field
+  uint64_t riff_size = data_header_offset + data_size + (data_size & 1) + chunks_size;
+
+  auto write_at = [&](uint64_t offset, const unsigned char *data, size_t size) {
+    if (!seek_to(file.get(), offset)) throw std::runtime_error("error writing " + path);
+    write_bytes(data, size);
+  };
+
+  unsigned char value[8];
+  for (auto &chunk_size : chunk_sizes) {
+    put_u32(value, chunk_size.size);
+    write_at(chunk_size.offset, value, 4);
+  }
+
+  if (riff_size > 0xFFFFFFFF || data_size > 0xFFFFFFFF) {
+    // convert to BW64, replacing the JUNK chunk with a ds64 chunk
+    unsigned char ds64[8 + ds64_size] = {};
+    put_id(ds64, "ds64");
+    put_u32(ds64 + 4, ds64_size);
+    put_u64(ds64 + 8, riff_size);
+    put_u64(ds64 + 16, data_size);
+    put_u64(ds64 + 24, channels_ ? data_size / (channels_ * sample_size) : 0);
+    write_at(ds64_offset, ds64, sizeof(ds64));
+
+    put_id(value, "BW64");
+    put_u32(value + 4, 0xFFFFFFFF);
+    write_at(0, value, 8);
+    write_at(data_header_offset + 4, value + 4, 4);
+  } else {
+    put_u32(value, static_cast<uint32_t>(riff_size));
+    write_at(4, value, 4);
+    put_u32(value, static_cast<uint32_t>(data_size));
+    write_at(data_header_offset + 4, value, 4);
+  }
+
+  auto closing = std::move(file);
+  if (std::fflush(closing.get()) != 0) throw std::runtime_error("error writing " + path);
+  if (std::fclose(closing.release()) != 0) throw std::runtime_error("error writing " + path);
+}
+
+void WavWriter::write_bytes(const void *data, size_t size) {
+  if (std::fwrite(data, 1, size, file.get()) != size) throw std::runtime_error("error writing " + path);
+}
+
+}  // namespace eat::process
@@ -0,0 +1,89 @@
+#pragma once
+#include <bw64/bw64.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "eat/process/adm_bw64.hpp"
+
+namespace eat::process {
+
+/// writes samples to a WAV file, which is converted to BW64 on close() if it
+/// is too large for RIFF
+///
+/// integer formats are converted with clipping, rounding to the nearest
+/// value; float32 samples are written as-is. the layout matches files written
+/// by libbw64, with a JUNK chunk reserving space for the ds64 chunk, and other
+/// chunks (axml, chna) after the samples
+class WavWriter {
+ public:
+  /// throws std::runtime_error if path could not be opened, or if it is being
+  /// read by a MappedWavReader
+  WavWriter(const std::string &path, size_t channels, unsigned int sample_rate, SampleFormat format);
+
+  WavWriter(const WavWriter &) = delete;
+  WavWriter &operator=(const WavWriter &) = delete;
+
+  /// closes the file if close() has not been called, ignoring errors
+  ~WavWriter();
+
+  size_t channels() const { return channels_; }
+
+  /// write n_frames frames of interleaved samples
+  void write(const float *samples, size_t n_frames);
+
+  /// write size bytes of samples from the file at source_path, starting at
+  /// offset, without converting them; they must be in the format of this file
+  ///
+  /// where possible, this is done without copying the data through this
+  /// process
+  void copy_samples(const std::string &source_path, uint64_t offset, uint64_t size);
+
+  /// writes the body of a chunk to a stream
+  using ChunkWriter = std::function<void(std::ostream &)>;
+
+  /// set a chunk with a 4-character ID to be written after the samples,
+  /// replacing any chunk with the same ID
+  ///
+  /// write is called by close(), and writes the body of the chunk directly to
+  /// the file, so large chunks (like axml) do not need to be held in memory
+  void set_chunk(const char *id, ChunkWriter write);
+
+  /// set a chunk to be written after the samples, replacing any chunk with
+  /// the same ID
+  void set_chunk(std::shared_ptr<bw64::Chunk> chunk);
+
+  /// write the chunks and finish the headers; no more samples or chunks may
+  /// be written after this
+  void close();
+
+ private:
+  struct FileDeleter {
+    void operator()(std::FILE *file) const { std::fclose(file); }
+  };
+
+  void write_bytes(const void *data, size_t size);
+
+  std::string path;
+  std::unique_ptr<std::FILE, FileDeleter> file;
+  size_t channels_;
+  SampleFormat format;
+  /// bytes per sample in the file
+  size_t sample_size;
+
+  uint64_t data_size = 0;
+  struct Chunk {
+    uint32_t id;
+    ChunkWriter write;
+  };
+  std::vector<Chunk> chunks;
+  /// converted samples, reused between calls to write()
+  std::vector<unsigned char> buffer;
+};
+
+}  // namespace eat::process
@@ -0,0 +1,64 @@
+#include "mixing.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+using namespace eat::render::mixing;
+
+namespace {
+using AlignedSamples = std::vector<float, AlignedAllocator<float>>;
+
+std::vector<AlignedSamples> make_channels(size_t n_channels, size_t n_samples) {
+  std::vector<AlignedSamples> channels;
+  for (size_t channel = 0; channel < n_channels; channel++)
+    channels.emplace_back(n_samples, 0.1f * static_cast<float>(channel + 1));
+  return channels;
+}
+}  // namespace
+
+TEST_CASE("bench mixing kernels") {
+  const size_t block_size = 1024;
+  // 4+5+0 without the LFE, and 2nd order HOA
+  const size_t n_speakers = 9;
+  const size_t n_hoa = 9;
+
+  auto in = make_channels(n_hoa, block_size);
+  auto out = make_channels(n_speakers, block_size);
+
+  for (const Kernels *k : supported_kernels()) {
+    std::string suffix = std::string{" "} + k->name;
+
+    BENCHMARK("add 1024" + suffix) {
+      k->add(out[0].data(), in[0].data(), block_size);
+      return out[0][0];
+    };
+
+    BENCHMARK("mix_constant 1024" + suffix) {
+      k->mix_constant(out[0].data(), in[0].data(), 0.5f, block_size);
+      return out[0][0];
+    };
+
+    BENCHMARK("mix_linear 1024" + suffix) {
+      k->mix_linear(out[0].data(), in[0].data(), 0.5f, 1e-4f, block_size);
+      return out[0][0];
+    };
+
+    // an Objects item moving through a block, like ObjectRenderer for the
+    // direct path of one object
+    BENCHMARK("object block" + suffix) {
+      for (size_t speaker = 0; speaker < n_speakers; speaker++)
+        k->mix_linear(out[speaker].data(), in[0].data(), 0.1f, 1e-5f, block_size);
+      return out[0][0];
+    };
+
+    // a static HOA item, like HOARenderer for one item
+    BENCHMARK("HOA block" + suffix) {
+      for (size_t hoa = 0; hoa < n_hoa; hoa++)
+        for (size_t speaker = 0; speaker < n_speakers; speaker++)
+          k->mix_constant(out[speaker].data(), in[hoa].data(), 0.1f, block_size);
+      return out[0][0];
+    };
+  }
+}
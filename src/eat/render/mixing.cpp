@@ -0,0 +1,74 @@
+#include "mixing.hpp"
+
+#ifdef EAT_MIXING_X86
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+namespace eat::render::mixing {
+
+namespace {
+
+struct Scalar {
+  static constexpr size_t width = 1;
+};
+
+#ifdef EAT_MIXING_X86
+struct CPUFeatures {
+  bool avx2 = false;
+  bool avx512 = false;
+};
+
+/// check the CPU and OS support for instruction sets above SSE2, which is
+/// always available on x86-64
+CPUFeatures get_cpu_features() {
+  CPUFeatures features;
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  int max_leaf = info[0];
+  if (max_leaf < 7) return features;
+
+  __cpuid(info, 1);
+  bool osxsave = info[2] & (1 << 27);
+  if (!osxsave) return features;
+  // the OS must save the YMM (and for AVX-512, opmask and ZMM) registers
+  unsigned long long xcr0 = _xgetbv(0);
+  bool ymm = (xcr0 & 0x6) == 0x6;
+  bool zmm = (xcr0 & 0xe6) == 0xe6;
+
+  __cpuidex(info, 7, 0);
+  features.avx2 = ymm && (info[1] & (1 << 5));
+  features.avx512 = zmm && (info[1] & (1 << 16));
+#else
+  __builtin_cpu_init();
+  features.avx2 = __builtin_cpu_supports("avx2");
+  features.avx512 = __builtin_cpu_supports("avx512f");
+#endif
+  return features;
+}
+#endif
+
+}  // namespace
+
+const Kernels scalar_kernels = detail::make_kernels<Scalar>("scalar");
+
+std::vector<const Kernels *> supported_kernels() {
+  std::vector<const Kernels *> supported{&scalar_kernels};
+#ifdef EAT_MIXING_X86
+  auto features = get_cpu_features();
+  supported.push_back(&sse2_kernels);
+  if (features.avx2) supported.push_back(&avx2_kernels);
+  if (features.avx512) supported.push_back(&avx512_kernels);
+#endif
+  return supported;
+}
+
+const Kernels &kernels() {
+  static const Kernels &best = *supported_kernels().back();
+  return best;
+}
+
+}  // namespace eat::render::mixing
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include "mixing_kernels.hpp"
+
+namespace eat::render::mixing {
+
+/// the kernels for the best instruction set supported by this CPU
+const Kernels &kernels();
+
+/// kernels for all instruction sets supported by this CPU and build, starting
+/// with scalar_kernels; for tests and benchmarks
+std::vector<const Kernels *> supported_kernels();
+
+inline void zero(float *out, size_t n) { kernels().zero(out, n); }
+inline void copy(float *out, const float *in, size_t n) { kernels().copy(out, in, n); }
+inline void add(float *out, const float *in, size_t n) { kernels().add(out, in, n); }
+inline void mix_constant(float *out, const float *in, float gain, size_t n) {
+  kernels().mix_constant(out, in, gain, n);
+}
+inline void mix_linear(float *out, const float *in, float gain, float step, size_t n) {
+  kernels().mix_linear(out, in, gain, step, n);
+}
+
+/// alignment of buffers passed to the kernels; they work with any alignment,
+/// but loads and stores which cross cache lines are slower
+constexpr size_t alignment = 64;
+
+/// allocator for buffers aligned to alignment
+template <typename T>
+struct AlignedAllocator {
+  using value_type = T;
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U> &) noexcept {}
+
+  T *allocate(size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t{alignment})); }
+  void deallocate(T *p, size_t) noexcept { ::operator delete(p, std::align_val_t{alignment}); }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U> &) const noexcept {
+    return true;
+  }
+};
+
+}  // namespace eat::render::mixing
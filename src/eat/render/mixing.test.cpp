@@ -0,0 +1,93 @@
+#include "mixing.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace eat::render::mixing;
+
+namespace {
+
+std::vector<float> test_samples(size_t n, float scale) {
+  std::vector<float> samples(n);
+  for (size_t i = 0; i < n; i++) samples[i] = scale * std::sin(0.1f * static_cast<float>(i) + scale);
+  return samples;
+}
+
+}  // namespace
+
+TEST_CASE("mixing kernels") {
+  auto supported = supported_kernels();
+  REQUIRE(supported.front() == &scalar_kernels);
+  REQUIRE(&kernels() == supported.back());
+
+  // lengths around the vector widths, with offsets to check unaligned buffers
+  size_t n = GENERATE(0, 1, 3, 4, 7, 8, 15, 16, 17, 33, 1029);
+  size_t offset = GENERATE(0, 1, 3);
+
+  std::vector<float> in_buffer = test_samples(n + offset, 0.5f);
+  std::vector<float> out_start = test_samples(n + offset, 0.25f);
+  const float *in = in_buffer.data() + offset;
+
+  const float gain = 0.75f;
+  const float step = -1.0f / 1024.0f;
+
+  // the expected results, calculated in double
+  std::vector<double> expected_add(n), expected_constant(n), expected_linear(n);
+  for (size_t i = 0; i < n; i++) {
+    double out = out_start[offset + i];
+    expected_add[i] = out + in[i];
+    expected_constant[i] = out + in[i] * static_cast<double>(gain);
+    expected_linear[i] = out + in[i] * (gain + static_cast<double>(i) * step);
+  }
+
+  auto check_close = [&](const std::vector<float> &out, const std::vector<double> &expected) {
+    for (size_t i = 0; i < n; i++) REQUIRE(std::abs(out[offset + i] - expected[i]) < 1e-6);
+  };
+
+  // results from the scalar kernels, which the others must match exactly
+  std::vector<std::vector<float>> scalar_results;
+
+  for (const Kernels *k : supported) {
+    INFO("kernels: " << k->name);
+    std::vector<std::vector<float>> results;
+
+    std::vector<float> out = out_start;
+    k->zero(out.data() + offset, n);
+    for (size_t i = 0; i < n; i++) REQUIRE(out[offset + i] == 0.0f);
+    // samples outside the range must not be touched
+    for (size_t i = 0; i < offset; i++) REQUIRE(out[i] == out_start[i]);
+
+    out = out_start;
+    k->copy(out.data() + offset, in, n);
+    for (size_t i = 0; i < n; i++) REQUIRE(out[offset + i] == in[i]);
+
+    out = out_start;
+    k->add(out.data() + offset, in, n);
+    check_close(out, expected_add);
+    results.push_back(out);
+
+    out = out_start;
+    k->mix_constant(out.data() + offset, in, gain, n);
+    check_close(out, expected_constant);
+    results.push_back(out);
+
+    out = out_start;
+    k->mix_linear(out.data() + offset, in, gain, step, n);
+    check_close(out, expected_linear);
+    results.push_back(out);
+
+    if (k == &scalar_kernels)
+      scalar_results = results;
+    else
+      REQUIRE(results == scalar_results);
+  }
+}
+
+TEST_CASE("mixing aligned allocator") {
+  std::vector<float, AlignedAllocator<float>> buffer(100);
+  REQUIRE(reinterpret_cast<uintptr_t>(buffer.data()) % alignment == 0);
+}
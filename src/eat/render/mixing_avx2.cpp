@@ -0,0 +1,27 @@
+// compiled with AVX2 enabled; see src/eat/CMakeLists.txt
+#include <immintrin.h>
+
+#include "mixing_kernels.hpp"
+
+namespace eat::render::mixing {
+
+namespace {
+
+struct AVX2 {
+  using type = __m256;
+  static constexpr size_t width = 8;
+
+  static type load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, type v) { _mm256_storeu_ps(p, v); }
+  static type set1(float x) { return _mm256_set1_ps(x); }
+  static type ramp() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+  static type zero() { return _mm256_setzero_ps(); }
+  static type add(type a, type b) { return _mm256_add_ps(a, b); }
+  static type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+};
+
+}  // namespace
+
+const Kernels avx2_kernels = detail::make_kernels<AVX2>("avx2");
+
+}  // namespace eat::render::mixing
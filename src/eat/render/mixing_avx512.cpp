@@ -0,0 +1,30 @@
+// compiled with AVX-512F enabled; see src/eat/CMakeLists.txt
+#include <immintrin.h>
+
+#include "mixing_kernels.hpp"
+
+namespace eat::render::mixing {
+
+namespace {
+
+struct AVX512 {
+  using type = __m512;
+  static constexpr size_t width = 16;
+
+  static type load(const float *p) { return _mm512_loadu_ps(p); }
+  static void store(float *p, type v) { _mm512_storeu_ps(p, v); }
+  static type set1(float x) { return _mm512_set1_ps(x); }
+  static type ramp() {
+    return _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f,
+                          14.0f, 15.0f);
+  }
+  static type zero() { return _mm512_setzero_ps(); }
+  static type add(type a, type b) { return _mm512_add_ps(a, b); }
+  static type mul(type a, type b) { return _mm512_mul_ps(a, b); }
+};
+
+}  // namespace
+
+const Kernels avx512_kernels = detail::make_kernels<AVX512>("avx512");
+
+}  // namespace eat::render::mixing
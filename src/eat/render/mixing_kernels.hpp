@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+
+// this is included in files compiled for specific instruction sets, so must
+// not include anything which defines inline functions, as the linker could
+// pick those versions for use elsewhere
+
+namespace eat::render::mixing {
+
+/// functions for mixing blocks of samples, implemented for one instruction
+/// set
+///
+/// all work with any alignment; out must not overlap in. results are the same
+/// for all instruction sets, as the same operations are done in the same
+/// order
+struct Kernels {
+  /// name of the instruction set, for tests and benchmarks
+  const char *name;
+
+  /// out[i] = 0
+  void (*zero)(float *out, size_t n);
+  /// out[i] = in[i]
+  void (*copy)(float *out, const float *in, size_t n);
+  /// out[i] += in[i]
+  void (*add)(float *out, const float *in, size_t n);
+  /// out[i] += in[i] * gain
+  void (*mix_constant)(float *out, const float *in, float gain, size_t n);
+  /// out[i] += in[i] * (gain + i * step), for linear gain ramps
+  void (*mix_linear)(float *out, const float *in, float gain, float step, size_t n);
+};
+
+extern const Kernels scalar_kernels;
+#ifdef EAT_MIXING_X86
+extern const Kernels sse2_kernels;
+extern const Kernels avx2_kernels;
+extern const Kernels avx512_kernels;
+#endif
+
+namespace detail {
+
+// implementations of the kernels, using a type V which wraps one instruction
+// set; it has a vector type, width (the number of floats in a vector), and
+// static functions load, store, set1, ramp (0, 1, 2...), zero, add and mul.
+// each loop does whole vectors, then the remaining samples one at a time,
+// using the same operations.
+
+template <typename V>
+void zero(float *out, size_t n) {
+  size_t i = 0;
+  if constexpr (V::width > 1)
+    for (; i + V::width <= n; i += V::width) V::store(out + i, V::zero());
+  for (; i < n; i++) out[i] = 0.0f;
+}
+
+template <typename V>
+void copy(float *out, const float *in, size_t n) {
+  size_t i = 0;
+  if constexpr (V::width > 1)
+    for (; i + V::width <= n; i += V::width) V::store(out + i, V::load(in + i));
+  for (; i < n; i++) out[i] = in[i];
+}
+
+template <typename V>
+void add(float *out, const float *in, size_t n) {
+  size_t i = 0;
+  if constexpr (V::width > 1)
+    for (; i + V::width <= n; i += V::width) V::store(out + i, V::add(V::load(out + i), V::load(in + i)));
+  for (; i < n; i++) out[i] = out[i] + in[i];
+}
+
+template <typename V>
+void mix_constant(float *out, const float *in, float gain, size_t n) {
+  size_t i = 0;
+  if constexpr (V::width > 1) {
+    auto gain_v = V::set1(gain);
+    for (; i + V::width <= n; i += V::width)
+      V::store(out + i, V::add(V::load(out + i), V::mul(V::load(in + i), gain_v)));
+  }
+  for (; i < n; i++) out[i] = out[i] + in[i] * gain;
+}
+
+template <typename V>
+void mix_linear(float *out, const float *in, float gain, float step, size_t n) {
+  // the index is converted to float, which is exact for any block size that
+  // could be used
+  size_t i = 0;
+  if constexpr (V::width > 1) {
+    auto gain_v = V::set1(gain);
+    auto step_v = V::set1(step);
+    auto ramp = V::ramp();
+    for (; i + V::width <= n; i += V::width) {
+      auto index = V::add(V::set1(static_cast<float>(i)), ramp);
+      auto gains = V::add(gain_v, V::mul(index, step_v));
+      V::store(out + i, V::add(V::load(out + i), V::mul(V::load(in + i), gains)));
+    }
+  }
+  for (; i < n; i++) out[i] = out[i] + in[i] * (gain + static_cast<float>(i) * step);
+}
+
+template <typename V>
+constexpr Kernels make_kernels(const char *name) {
+  return {name, zero<V>, copy<V>, add<V>, mix_constant<V>, mix_linear<V>};
+}
+
+}  // namespace detail
+
+}  // namespace eat::render::mixing
@@ -0,0 +1,27 @@
+// compiled with SSE2 enabled; see src/eat/CMakeLists.txt
+#include <emmintrin.h>
+
+#include "mixing_kernels.hpp"
+
+namespace eat::render::mixing {
+
+namespace {
+
+struct SSE2 {
+  using type = __m128;
+  static constexpr size_t width = 4;
+
+  static type load(const float *p) { return _mm_loadu_ps(p); }
+  static void store(float *p, type v) { _mm_storeu_ps(p, v); }
+  static type set1(float x) { return _mm_set1_ps(x); }
+  static type ramp() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+  static type zero() { return _mm_setzero_ps(); }
+  static type add(type a, type b) { return _mm_add_ps(a, b); }
+  static type mul(type a, type b) { return _mm_mul_ps(a, b); }
+};
+
+}  // namespace
+
+const Kernels sse2_kernels = detail::make_kernels<SSE2>("sse2");
+
+}  // namespace eat::render::mixing
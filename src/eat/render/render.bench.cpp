@@ -0,0 +1,97 @@
+#include "eat/render/render.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <ear/bs2051.hpp>
+
+#include "../utilities/synthetic.hpp"
+#include "eat/framework/evaluate.hpp"
+#include "eat/framework/utility_processes.hpp"
+#include "eat/process/adm_bw64.hpp"
+#include "eat/process/block.hpp"
+
+using namespace eat::framework;
+using namespace eat::process;
+using namespace eat::render;
+using namespace eat::utilities;
+
+namespace {
+struct RenderCase {
+  std::string name;
+  SyntheticADMOptions options;
+  size_t n_threads = 1;
+};
+}  // namespace
+
+TEST_CASE("bench render") {
+  const unsigned int sample_rate = 48000;
+  const size_t block_size = 1024;
+
+  auto render_case = GENERATE(RenderCase{"16 objects", {16, 0, 0}},
+                              RenderCase{"64 objects", {64, 0, 0}},
+                              RenderCase{"64 objects 4 threads", {64, 0, 0}, 4},
+                              RenderCase{"64 sparse objects", {64, 0, 0, std::chrono::milliseconds{10000},
+                                                               std::chrono::milliseconds{100}, 10}},
+                              RenderCase{"8 stereo DirectSpeakers", {0, 8, 0}},
+                              RenderCase{"4 2nd order HOA", {0, 0, 4}});
+  auto &options = render_case.options;
+
+  ADMData adm = make_synthetic_adm(options);
+  size_t n_channels = synthetic_channel_count(options);
+  size_t n_frames = static_cast<size_t>(options.duration.count()) * sample_rate / 1000;
+  auto samples = make_synthetic_samples(n_channels, n_frames);
+
+  auto layout = ear::getLayout("4+5+0");
+
+  BENCHMARK_ADVANCED("render " + render_case.name + " to 4+5+0 10s")(Catch::Benchmark::Chronometer meter) {
+    measure_run(meter, [&]() {
+      Graph g;
+      auto adm_source = g.add_process<DataSource<ADMData>>("adm_source", adm);
+      auto samples_source = g.add_process<InterleavedStreamingAudioSource>(
+          "samples_source", samples, BlockDescription{block_size, n_channels, sample_rate});
+      auto renderer = g.register_process(make_render("renderer", layout, block_size, {}, render_case.n_threads));
+      auto samples_sink = g.add_process<DiscardSamples>("samples_sink");
+
+      g.connect(adm_source->get_out_port("out"), renderer->get_in_port("in_axml"));
+      g.connect(samples_source->get_out_port("out_samples"), renderer->get_in_port("in_samples"));
+      g.connect(renderer->get_out_port("out_samples"), samples_sink->get_in_port("in_samples"));
+      return g;
+    });
+  };
+}
+
+TEST_CASE("bench render setup") {
+  const unsigned int sample_rate = 48000;
+  const size_t block_size = 1024;
+
+  // 32 objects with an audioBlockFormat every 20ms for a minute (96000
+  // blocks); like real dense metadata, positions are often repeated
+  SyntheticADMOptions options{32, 0, 0, std::chrono::milliseconds{60000}, std::chrono::milliseconds{20}};
+  ADMData adm = make_synthetic_adm(options);
+  size_t n_channels = synthetic_channel_count(options);
+  // only one block of samples, so that the time is dominated by setting up
+  // the renderer
+  auto samples = make_synthetic_samples(n_channels, block_size);
+
+  auto layout = ear::getLayout("4+5+0");
+
+  const size_t n_threads = GENERATE(1, 4);
+
+  BENCHMARK_ADVANCED("render setup 96000 blocks " + std::to_string(n_threads) + " threads")
+  (Catch::Benchmark::Chronometer meter) {
+    measure_run(meter, [&]() {
+      Graph g;
+      auto adm_source = g.add_process<DataSource<ADMData>>("adm_source", adm);
+      auto samples_source = g.add_process<InterleavedStreamingAudioSource>(
+          "samples_source", samples, BlockDescription{block_size, n_channels, sample_rate});
+      auto renderer = g.register_process(make_render("renderer", layout, block_size, {}, n_threads));
+      auto samples_sink = g.add_process<DiscardSamples>("samples_sink");
+
+      g.connect(adm_source->get_out_port("out"), renderer->get_in_port("in_axml"));
+      g.connect(samples_source->get_out_port("out_samples"), renderer->get_in_port("in_samples"));
+      g.connect(renderer->get_out_port("out_samples"), samples_sink->get_in_port("in_samples"));
+      return g;
+    });
+  };
+}
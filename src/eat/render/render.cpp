@@ -2,15 +2,28 @@
 
 #include <adm/document.hpp>
 #include <adm/utilities/time_conversion.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <ear/dsp/dsp.hpp>
 #include <ear/ear.hpp>
+#include <iterator>
 #include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "eat/framework/exceptions.hpp"
 #include "eat/process/adm_bw64.hpp"
 #include "eat/process/block.hpp"
 #include "eat/render/rendering_items.hpp"
+#include "mixing.hpp"
+#include "task_pool.hpp"
 
 using namespace eat::framework;
 using namespace eat::process;
@@ -18,6 +31,7 @@ using namespace eat::render;
 
 namespace {
 
+/// planar buffer of samples; each channel is aligned for the mixing kernels
 class Buffer {
  public:
   Buffer() {}
@@ -29,44 +43,36 @@ class Buffer {
 
   float *channel_ptr(size_t i) { return pointers.at(i); }
 
-  void zero() {
-    for (size_t i = 0; i < samples.size(); i++) samples[i] = 0.0f;
-  }
+  void zero() { mixing::zero(samples.data(), samples.size()); }
 
-  void add(Buffer &other) {
-    for (size_t i = 0; i < samples.size(); i++) samples[i] += other.samples[i];
-  }
+  /// add other, which must have the same size
+  void add(Buffer &other) { mixing::add(samples.data(), other.samples.data(), samples.size()); }
 
   void resize(size_t n_channels_, size_t n_samples_) {
     if (n_channels_ != n_channels || n_samples_ != n_samples) {
       n_channels = n_channels_;
       n_samples = n_samples_;
 
-      samples.resize(n_samples * n_channels);
+      // round channels up to a whole number of aligned blocks
+      constexpr size_t align_samples = mixing::alignment / sizeof(float);
+      size_t stride = (n_samples + align_samples - 1) / align_samples * align_samples;
+
+      samples.resize(stride * n_channels);
       pointers.resize(n_channels);
       for (size_t channel_i = 0; channel_i < n_channels; channel_i++)
-        pointers[channel_i] = samples.data() + channel_i * n_samples;
+        pointers[channel_i] = samples.data() + channel_i * stride;
     }
   }
 
-  void from_interleaved(const InterleavedSampleBlock &b) {
-    auto &info = b.info();
-    resize(info.channel_count, info.sample_count);
-
-    for (size_t channel_i = 0; channel_i < n_channels; channel_i++)
-      for (size_t sample_i = 0; sample_i < n_samples; sample_i++)
-        pointers[channel_i][sample_i] = b.sample(channel_i, sample_i);
-  }
-
-  InterleavedSampleBlock to_interleaved(unsigned int sample_rate, size_t start = 0) {
+  /// copy samples from start onwards into a planar block
+  PlanarSampleBlock to_planar(unsigned int sample_rate, size_t start = 0) {
     assert(start < n_samples);
-    BlockDescription info{n_samples - start, pointers.size(), sample_rate};
+    BlockDescription info{n_samples - start, n_channels, sample_rate};
 
-    InterleavedSampleBlock block{info};
+    PlanarSampleBlock block{info};
 
     for (size_t channel_i = 0; channel_i < n_channels; channel_i++)
-      for (size_t sample_i = 0; sample_i < info.sample_count; sample_i++)
-        block.sample(channel_i, sample_i) = pointers[channel_i][start + sample_i];
+      mixing::copy(block.data() + channel_i * info.sample_count, pointers[channel_i] + start, info.sample_count);
 
     return block;
   }
@@ -74,19 +80,17 @@ class Buffer {
  private:
   size_t n_channels = 0;
   size_t n_samples = 0;
-  std::vector<float> samples;
+  std::vector<float, mixing::AlignedAllocator<float>> samples;
   std::vector<float *> pointers;
 };
 
 void zero_samples(float *const *samples, size_t n_channels, size_t n_samples) {
-  for (size_t channel_i = 0; channel_i < n_channels; channel_i++)
-    for (size_t sample_i = 0; sample_i < n_samples; sample_i++) samples[channel_i][sample_i] = 0.0f;
+  for (size_t channel_i = 0; channel_i < n_channels; channel_i++) mixing::zero(samples[channel_i], n_samples);
 }
 
 /// a += b
 void add_samples(float *const *a, float *const *b, size_t n_channels, size_t n_samples) {
-  for (size_t channel_i = 0; channel_i < n_channels; channel_i++)
-    for (size_t sample_i = 0; sample_i < n_samples; sample_i++) a[channel_i][sample_i] += b[channel_i][sample_i];
+  for (size_t channel_i = 0; channel_i < n_channels; channel_i++) mixing::add(a[channel_i], b[channel_i], n_samples);
 }
 
 /// write from in to out, zeroing channels in out where is_lfe is true
@@ -95,10 +99,10 @@ void write_non_lfe(float *const *out, const float *const *in, const std::vector<
   size_t in_channel = 0;
   for (size_t out_channel = 0; out_channel < n_channels_out; out_channel++) {
     if (is_lfe.at(out_channel)) {
-      for (size_t sample = 0; sample < n_samples; sample++) out[out_channel][sample] = 0.0f;
+      mixing::zero(out[out_channel], n_samples);
     } else {
       always_assert(in_channel < n_channels_in, "fewer LFE channels than expected");
-      for (size_t sample = 0; sample < n_samples; sample++) out[out_channel][sample] = in[in_channel][sample];
+      mixing::copy(out[out_channel], in[in_channel], n_samples);
       in_channel++;
     }
   }
@@ -132,13 +136,9 @@ RenderTrackSpec to_render_track_spec(const TrackSpec &spec, const channel_map_t
 }
 
 struct RenderTrackSpecVisitor {
-  void operator()(const RenderDirectTrackSpec &spec) noexcept {
-    for (size_t sample_i = 0; sample_i < n_samples; sample_i++) out[sample_i] = in[spec.track_idx][sample_i];
-  }
+  void operator()(const RenderDirectTrackSpec &spec) noexcept { mixing::copy(out, in[spec.track_idx], n_samples); }
 
-  void operator()(const SilentTrackSpec &) noexcept {
-    for (size_t sample_i = 0; sample_i < n_samples; sample_i++) out[sample_i] = 0.0f;
-  }
+  void operator()(const SilentTrackSpec &) noexcept { mixing::zero(out, n_samples); }
 
   const float *const *in;
   float *out;
@@ -326,6 +326,139 @@ class InterpretTimingMetadata {
   RI &ri;
 };
 
+bool all_zero(const std::vector<float> &gains) {
+  return std::all_of(gains.begin(), gains.end(), [](float g) { return g == 0.0f; });
+}
+
+bool all_zero(const std::vector<std::vector<float>> &gains) {
+  return std::all_of(gains.begin(), gains.end(), [](const std::vector<float> &g) { return all_zero(g); });
+}
+
+/// add in * gain to out for n samples, where gain is interpolated linearly
+/// from a (at pos = 0) to b (at pos = 1), starting at pos and increasing by
+/// step each sample
+void mix_segment(float *out, const float *in, float a, float b, double pos, double step, size_t n) {
+  if (a == b) {
+    if (a != 0.0f) mixing::mix_constant(out, in, a, n);
+  } else {
+    double diff = static_cast<double>(b) - static_cast<double>(a);
+    mixing::mix_linear(out, in, static_cast<float>(a + diff * pos), static_cast<float>(diff * step), n);
+  }
+}
+
+/// mix_segment for gains from one input to each output channel
+void mix_segment(const std::vector<float> &a, const std::vector<float> &b, double pos, double step,
+                 const float *const *in, float *const *out, size_t offset, size_t n) {
+  for (size_t out_channel = 0; out_channel < a.size(); out_channel++)
+    mix_segment(out[out_channel] + offset, in[0] + offset, a[out_channel], b[out_channel], pos, step, n);
+}
+
+/// mix_segment for gains indexed by input then output channel
+void mix_segment(const std::vector<std::vector<float>> &a, const std::vector<std::vector<float>> &b, double pos,
+                 double step, const float *const *in, float *const *out, size_t offset, size_t n) {
+  for (size_t in_channel = 0; in_channel < a.size(); in_channel++)
+    for (size_t out_channel = 0; out_channel < a[in_channel].size(); out_channel++)
+      mix_segment(out[out_channel] + offset, in[in_channel] + offset, a[in_channel][out_channel],
+                  b[in_channel][out_channel], pos, step, n);
+}
+
+/// piecewise-linear gains, applied to blocks of input samples and added to
+/// the output
+///
+/// the points are interpreted like ear::dsp::GainInterpolator: gains are
+/// interpolated linearly between points, and held before the first and after
+/// the last. rather than writing to a temporary buffer, the result is mixed
+/// straight into the output, and channels with zero gain are skipped
+///
+/// Gains is a vector of gains for each output channel (for one input
+/// channel), or a vector of these for each input channel
+template <typename Gains>
+struct GainRamp {
+  /// pairs of sample index and gains, sorted by sample index; two points at
+  /// the same index make a step
+  std::vector<std::pair<long int, Gains>> interp_points;
+
+  /// add the output for n_samples samples starting at block_start to out
+  void mix(long int block_start, size_t n_samples, const float *const *in, float *const *out) const {
+    long int block_end = block_start + static_cast<long int>(n_samples);
+
+    using Point = std::pair<long int, Gains>;
+    auto next = std::upper_bound(interp_points.begin(), interp_points.end(), block_start,
+                                 [](long int sample, const Point &point) { return sample < point.first; });
+
+    for (long int sample = block_start; sample < block_end && !interp_points.empty();) {
+      // the first point after sample
+      while (next != interp_points.end() && next->first <= sample) ++next;
+
+      long int end = next == interp_points.end() ? block_end : std::min(block_end, next->first);
+      auto offset = static_cast<size_t>(sample - block_start);
+      auto n = static_cast<size_t>(end - sample);
+
+      if (next == interp_points.begin()) {
+        mix_segment(next->second, next->second, 0.0, 0.0, in, out, offset, n);
+      } else if (next == interp_points.end()) {
+        auto &last = interp_points.back().second;
+        mix_segment(last, last, 0.0, 0.0, in, out, offset, n);
+      } else {
+        auto prev = std::prev(next);
+        double length = static_cast<double>(next->first - prev->first);
+        double pos = static_cast<double>(sample - prev->first) / length;
+        mix_segment(prev->second, next->second, pos, 1.0 / length, in, out, offset, n);
+      }
+
+      sample = end;
+    }
+  }
+};
+
+/// ranges of samples in which the output of a GainRamp may be non-zero, used
+/// to skip items which are silent for a whole block
+///
+/// between two interpolation points the output is zero if the gains at both
+/// points are zero; before the first and after the last point, the gains of
+/// that point are used
+class ActiveRanges {
+ public:
+  ActiveRanges() = default;
+
+  template <typename Gains>
+  explicit ActiveRanges(const GainRamp<Gains> &ramp) {
+    auto &points = ramp.interp_points;
+    if (points.empty()) return;
+
+    if (!all_zero(points.front().second)) add(min_sample, points.front().first);
+    for (size_t i = 0; i + 1 < points.size(); i++)
+      if (!all_zero(points[i].second) || !all_zero(points[i + 1].second)) add(points[i].first, points[i + 1].first);
+    if (!all_zero(points.back().second)) add(points.back().first, max_sample);
+  }
+
+  /// may the output be non-zero for any sample in [start, end)?
+  bool active(long int start, long int end) const {
+    // first range ending after start
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), start,
+                               [](long int sample, const Range &range) { return sample < range.second; });
+    return it != ranges.end() && it->first < end;
+  }
+
+ private:
+  static constexpr long int min_sample = std::numeric_limits<long int>::min();
+  static constexpr long int max_sample = std::numeric_limits<long int>::max();
+
+  /// add [start, end), merging with the last range if they touch; ranges are
+  /// added in order
+  void add(long int start, long int end) {
+    if (start >= end) return;
+    if (!ranges.empty() && start <= ranges.back().second)
+      ranges.back().second = std::max(ranges.back().second, end);
+    else
+      ranges.emplace_back(start, end);
+  }
+
+  /// sorted, non-overlapping [start, end) pairs
+  using Range = std::pair<long int, long int>;
+  std::vector<Range> ranges;
+};
+
 struct ConvertPositionVisitor : public boost::static_visitor<ear::Position> {
   ear::Position operator()(const adm::SphericalPosition &pos) const {
     return ear::PolarPosition{pos.get<adm::Azimuth>().get(), pos.get<adm::Elevation>().get(),
@@ -391,6 +524,37 @@ ear::ObjectsTypeMetadata to_otm(const ObjectRenderingItem &ri, const adm::AudioB
   return otm;
 }
 
+/// the values in ObjectsTypeMetadata which are set by to_otm, and therefore
+/// determine the gains calculated for an Objects audioBlockFormat; this is used
+/// to avoid calculating the same gains more than once, as blocks often repeat
+/// the same parameters
+using ObjectsGainsKey = std::vector<double>;
+
+ObjectsGainsKey objects_gains_key(const ear::ObjectsTypeMetadata &otm) {
+  ObjectsGainsKey key;
+
+  if (auto polar = boost::get<ear::PolarPosition>(&otm.position))
+    key = {0.0, polar->azimuth, polar->elevation, polar->distance};
+  else {
+    auto &cartesian = boost::get<ear::CartesianPosition>(otm.position);
+    key = {1.0, cartesian.X, cartesian.Y, cartesian.Z};
+  }
+
+  if (auto polar = boost::get<ear::PolarObjectDivergence>(&otm.objectDivergence))
+    key.insert(key.end(), {0.0, polar->divergence, polar->azimuthRange});
+  else {
+    auto &cartesian = boost::get<ear::CartesianObjectDivergence>(otm.objectDivergence);
+    key.insert(key.end(), {1.0, cartesian.divergence, cartesian.positionRange});
+  }
+
+  boost::optional<double> max_distance = otm.channelLock.maxDistance;
+  key.insert(key.end(), {otm.width, otm.height, otm.depth, static_cast<double>(otm.cartesian), otm.gain, otm.diffuse,
+                         static_cast<double>(otm.channelLock.flag), max_distance ? 1.0 : 0.0,
+                         max_distance.value_or(0.0), static_cast<double>(otm.screenRef)});
+
+  return key;
+}
+
 ear::ScreenEdgeLock get_edge_lock(const adm::ScreenEdgeLock &edge_lock) {
   ear::ScreenEdgeLock ear_edge_lock;
 
@@ -476,26 +640,62 @@ auto round(adm::RationalTime t) {
   return x.numerator() / x.denominator();
 }
 
+using DecorrelationFilters = decltype(ear::designDecorrelators(std::declval<const ear::Layout &>()));
+
+/// ear::designDecorrelators, memoised by channel names (which are all that
+/// the design depends on), because renderers for the same layout are often
+/// made many times in one process, for example in eat-process batch mode
+std::shared_ptr<const DecorrelationFilters> design_decorrelators(const ear::Layout &layout) {
+  static std::mutex mutex;
+  static std::map<std::vector<std::string>, std::shared_ptr<const DecorrelationFilters>> cache;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &filters = cache[layout.channelNames()];
+  if (!filters) filters = std::make_shared<const DecorrelationFilters>(ear::designDecorrelators(layout));
+  return filters;
+}
+
+/// the sample at time in a stream with the given sample rate, rounded to the
+/// nearest sample; whole seconds are converted separately, so that this does
+/// not overflow for long times
+long int time_to_sample(std::chrono::nanoseconds time, unsigned int sample_rate) {
+  auto seconds = std::chrono::floor<std::chrono::seconds>(time);
+  int64_t remainder = (time - seconds).count();
+  return static_cast<long int>(seconds.count() * sample_rate + (remainder * sample_rate + 500000000) / 1000000000);
+}
+
 }  // namespace
 
+/// renders objects
+///
+/// with more than one thread, the objects are split into a contiguous range
+/// for each thread, which are rendered into separate buffers and then summed
+/// in order. the output is the same on every run with the same number of
+/// threads, but may differ slightly (because of rounding) from the output with
+/// a different number of threads
 class ObjectRenderer {
  public:
-  ObjectRenderer(const ear::Layout &layout, ear::dsp::block_convolver::Context &convolver_ctx, size_t block_size_)
+  ObjectRenderer(const ear::Layout &layout, ear::dsp::block_convolver::Context &convolver_ctx, size_t block_size_,
+                 size_t n_threads)
       : block_size(block_size_),
         n_channels(layout.withoutLfe().channels().size()),
         n_channels_out(layout.channels().size()),
         is_lfe(layout.isLfe()),
         decorrelator_delay(n_channels, static_cast<size_t>(ear::decorrelatorCompensationDelay())),
-        gain_calc(layout.withoutLfe()),
-        temp_mono(1, block_size),
+        pool(n_threads),
         temp(n_channels, block_size),
-        temp_direct(n_channels, block_size),
-        temp_diffuse(n_channels, block_size),
         temp_out(n_channels, block_size) {
-    auto decorrelation_filters = ear::designDecorrelators(layout);
-    for (size_t i = 0; i < decorrelation_filters.size(); i++) {
+    for (size_t i = 0; i < pool.size(); i++) {
+      partials.push_back({Buffer(1, block_size), Buffer(n_channels, block_size), Buffer(n_channels, block_size)});
+      gain_calcs.push_back(std::make_unique<ear::GainCalculatorObjects>(layout.withoutLfe()));
+    }
+
+    auto decorrelation_filters = design_decorrelators(layout);
+    for (size_t i = 0; i < decorrelation_filters->size(); i++) {
       if (!is_lfe.at(i)) {
-        auto &filter = decorrelation_filters.at(i);
+        auto &filter = decorrelation_filters->at(i);
+        // the block containing the end of the filter, plus one for overlap
+        decorrelator_blocks = std::max(decorrelator_blocks, (filter.size() + block_size - 1) / block_size + 1);
         ear::dsp::block_convolver::Filter filter_obj(convolver_ctx, filter.size(), filter.data());
         decorrelators.emplace_back(
             std::make_unique<ear::dsp::block_convolver::BlockConvolver>(convolver_ctx, filter_obj));
@@ -507,41 +707,28 @@ class ObjectRenderer {
                              const channel_map_t &channel_map) {
     n_objects = rendering_items.size();
 
-    direct_gain_interpolators.clear();
-    diffuse_gain_interpolators.clear();
+    // the items are split between threads like in process(), with a gain
+    // calculator and cache for each part
+    std::vector<ItemGains> item_gains(n_objects);
+    size_t n_parts = std::max<size_t>(std::min(pool.size(), n_objects), 1);
+    pool.run(n_parts, [&](size_t part) {
+      GainsCache cache;
+      for (size_t i = n_objects * part / n_parts; i < n_objects * (part + 1) / n_parts; i++)
+        item_gains[i] = calculate_item_gains(fs, *rendering_items[i], *gain_calcs[part], cache);
+    });
+
+    direct_gains.clear();
+    diffuse_gains.clear();
+    direct_active.clear();
+    diffuse_active.clear();
     track_specs.clear();
 
-    for (auto &ri : rendering_items) {
-      GainInterpolator direct_gain_interp;
-      GainInterpolator diffuse_gain_interp;
-
-      InterpretTimingMetadata<ObjectRenderingItem> interp(*ri);
-
-      std::vector<float> direct_gains(n_channels), diffuse_gains(n_channels);
-
-      auto push_point = [&](const InterpPoint &point) {
-        long int sample = round(fs * point.time);
-        if (point.zero) {
-          direct_gain_interp.interp_points.emplace_back(sample, std::vector<float>(n_channels, 0.0));
-          diffuse_gain_interp.interp_points.emplace_back(sample, std::vector<float>(n_channels, 0.0));
-        } else {
-          direct_gain_interp.interp_points.emplace_back(sample, direct_gains);
-          diffuse_gain_interp.interp_points.emplace_back(sample, diffuse_gains);
-        }
-      };
-
-      for (auto &bf : ri->adm_path.audioChannelFormat->getElements<adm::AudioBlockFormatObjects>()) {
-        direct_gains.resize(n_channels);
-        diffuse_gains.resize(n_channels);
-        gain_calc.calculate(to_otm(*ri, bf), direct_gains, diffuse_gains);
-        for (const auto &point : interp.get_interp_points(bf)) push_point(point);
-      }
-
-      for (const auto &point : interp.get_end_points()) push_point(point);
-
-      direct_gain_interpolators.push_back(std::move(direct_gain_interp));
-      diffuse_gain_interpolators.push_back(std::move(diffuse_gain_interp));
-      track_specs.push_back(to_render_track_spec(ri->track_spec, channel_map));
+    for (size_t i = 0; i < n_objects; i++) {
+      direct_active.emplace_back(item_gains[i].direct);
+      diffuse_active.emplace_back(item_gains[i].diffuse);
+      direct_gains.push_back(std::move(item_gains[i].direct));
+      diffuse_gains.push_back(std::move(item_gains[i].diffuse));
+      track_specs.push_back(to_render_track_spec(rendering_items[i]->track_spec, channel_map));
     }
   }
 
@@ -552,33 +739,44 @@ class ObjectRenderer {
 
   size_t delay() { return static_cast<size_t>(ear::decorrelatorCompensationDelay()); }
 
+  void set_start(long int start) { block_start = start; }
+
   void process(const float *const *in, float *const *out) {
     // flows:
     // for each object:
     //   in -> render track spec -> temp_mono
-    //   temp_mono -> direct gains -> temp -> sum to temp_direct
-    //   temp_mono -> difuse gains -> temp -> sum to temp_diffuse
+    //   temp_mono -> direct gains -> sum to temp_direct
+    //   temp_mono -> difuse gains -> sum to temp_diffuse
     //
     // temp_direct -> delays -> temp_out
     // temp_diffuse -> decorrelators -> temp -> add to temp_out
     // temp_out -> distribute to out
 
-    temp_direct.zero();
-    temp_diffuse.zero();
-    for (size_t i = 0; i < n_objects; i++) {
-      render_track_spec(in, *temp_mono.ptrs(), block_size, track_specs[i]);
-
-      direct_gain_interpolators[i].process(block_start, block_size, temp_mono.ptrs(), temp.ptrs());
-      temp_direct.add(temp);
-
-      diffuse_gain_interpolators[i].process(block_start, block_size, temp_mono.ptrs(), temp.ptrs());
-      temp_diffuse.add(temp);
+    size_t n_parts = std::max<size_t>(std::min(pool.size(), n_objects), 1);
+    pool.run(n_parts, [&](size_t part) {
+      render_objects(in, n_objects * part / n_parts, n_objects * (part + 1) / n_parts, partials[part]);
+    });
+
+    Buffer &temp_direct = partials[0].direct;
+    Buffer &temp_diffuse = partials[0].diffuse;
+    bool any_diffuse = partials[0].any_diffuse;
+    for (size_t part = 1; part < n_parts; part++) {
+      temp_direct.add(partials[part].direct);
+      temp_diffuse.add(partials[part].diffuse);
+      any_diffuse = any_diffuse || partials[part].any_diffuse;
     }
 
     decorrelator_delay.process(block_size, temp_direct.ptrs(), temp_out.ptrs());
-    for (size_t channel_i = 0; channel_i < n_channels; channel_i++)
-      decorrelators[channel_i]->process(temp_diffuse.ptrs()[channel_i], temp.ptrs()[channel_i]);
-    temp_out.add(temp);
+
+    // once the decorrelators have been given only zeros for longer than their
+    // filters, their output and state are all zero, so they can be skipped
+    // until there is some diffuse input again
+    silent_diffuse_blocks = any_diffuse ? 0 : silent_diffuse_blocks + 1;
+    if (silent_diffuse_blocks <= decorrelator_blocks) {
+      for (size_t channel_i = 0; channel_i < n_channels; channel_i++)
+        decorrelators[channel_i]->process(temp_diffuse.ptrs()[channel_i], temp.ptrs()[channel_i]);
+      temp_out.add(temp);
+    }
 
     write_non_lfe(out, temp_out.ptrs(), is_lfe, n_channels, n_channels_out, block_size);
 
@@ -586,31 +784,116 @@ class ObjectRenderer {
   }
 
  private:
+  /// buffers for rendering some of the objects
+  struct Partial {
+    Buffer temp_mono;
+    Buffer direct;
+    Buffer diffuse;
+    /// did any object contribute to diffuse?
+    bool any_diffuse = false;
+  };
+
+  using GainInterpolator = GainRamp<std::vector<float>>;
+
+  struct ItemGains {
+    GainInterpolator direct;
+    GainInterpolator diffuse;
+  };
+
+  /// direct and diffuse gains for each ObjectsGainsKey
+  using GainsCache = std::map<ObjectsGainsKey, std::pair<std::vector<float>, std::vector<float>>>;
+
+  /// calculate the gains for one item, using cache to avoid calculating the
+  /// gains for the same parameters more than once
+  ItemGains calculate_item_gains(unsigned int fs, const ObjectRenderingItem &ri, ear::GainCalculatorObjects &gain_calc,
+                                 GainsCache &cache) const {
+    ItemGains gains;
+
+    InterpretTimingMetadata<ObjectRenderingItem> interp(ri);
+
+    const std::vector<float> zero_gains(n_channels, 0.0f);
+    const std::vector<float> *direct = &zero_gains;
+    const std::vector<float> *diffuse = &zero_gains;
+
+    auto push_point = [&](const InterpPoint &point) {
+      long int sample = round(fs * point.time);
+      gains.direct.interp_points.emplace_back(sample, point.zero ? zero_gains : *direct);
+      gains.diffuse.interp_points.emplace_back(sample, point.zero ? zero_gains : *diffuse);
+    };
+
+    for (auto &bf : ri.adm_path.audioChannelFormat->getElements<adm::AudioBlockFormatObjects>()) {
+      ear::ObjectsTypeMetadata otm = to_otm(ri, bf);
+      auto [it, inserted] = cache.try_emplace(objects_gains_key(otm));
+      auto &[direct_cached, diffuse_cached] = it->second;
+      if (inserted) {
+        direct_cached.resize(n_channels);
+        diffuse_cached.resize(n_channels);
+        gain_calc.calculate(otm, direct_cached, diffuse_cached);
+      }
+      direct = &direct_cached;
+      diffuse = &diffuse_cached;
+
+      for (const auto &point : interp.get_interp_points(bf)) push_point(point);
+    }
+
+    for (const auto &point : interp.get_end_points()) push_point(point);
+
+    return gains;
+  }
+
+  /// render objects [begin, end) into partial.direct and partial.diffuse,
+  /// skipping the direct or diffuse paths of objects which are silent for
+  /// this block
+  void render_objects(const float *const *in, size_t begin, size_t end, Partial &partial) {
+    partial.direct.zero();
+    partial.diffuse.zero();
+    partial.any_diffuse = false;
+
+    long int block_end = block_start + static_cast<long int>(block_size);
+    for (size_t i = begin; i < end; i++) {
+      bool direct = direct_active[i].active(block_start, block_end);
+      bool diffuse = diffuse_active[i].active(block_start, block_end);
+      if (!direct && !diffuse) continue;
+
+      render_track_spec(in, *partial.temp_mono.ptrs(), block_size, track_specs[i]);
+
+      if (direct) direct_gains[i].mix(block_start, block_size, partial.temp_mono.ptrs(), partial.direct.ptrs());
+
+      if (diffuse) {
+        diffuse_gains[i].mix(block_start, block_size, partial.temp_mono.ptrs(), partial.diffuse.ptrs());
+        partial.any_diffuse = true;
+      }
+    }
+  }
+
   long int block_start = 0;
   size_t block_size;
   size_t n_channels;  // number of non-LFE channels to be processes internally (size of gains, delays, decorrelators)
   size_t n_channels_out;  // number of channels including LFE
-  size_t n_objects;
+  size_t n_objects = 0;
 
   std::vector<bool> is_lfe;
 
   std::vector<RenderTrackSpec> track_specs;
 
-  using InterpType = ear::dsp::LinearInterpVector;
-  using GainInterpolator = ear::dsp::GainInterpolator<InterpType>;
-
-  std::vector<GainInterpolator> direct_gain_interpolators;
-  std::vector<GainInterpolator> diffuse_gain_interpolators;
+  std::vector<GainInterpolator> direct_gains;
+  std::vector<GainInterpolator> diffuse_gains;
+  std::vector<ActiveRanges> direct_active;
+  std::vector<ActiveRanges> diffuse_active;
 
   std::vector<std::unique_ptr<ear::dsp::block_convolver::BlockConvolver>> decorrelators;
   ear::dsp::DelayBuffer decorrelator_delay;
-
-  ear::GainCalculatorObjects gain_calc;
-
-  Buffer temp_mono;
+  /// number of blocks of input which affect the output of the decorrelators
+  size_t decorrelator_blocks = 0;
+  /// number of blocks since there was any diffuse input
+  size_t silent_diffuse_blocks = 0;
+
+  TaskPool pool;
+  /// one for each thread in pool
+  std::vector<Partial> partials;
+  /// one for each thread in pool, as they may not be used concurrently
+  std::vector<std::unique_ptr<ear::GainCalculatorObjects>> gain_calcs;
   Buffer temp;
-  Buffer temp_direct;
-  Buffer temp_diffuse;
   Buffer temp_out;
 };
 
@@ -620,8 +903,7 @@ class DirectSpeakersRenderer {
       : block_size(block_size_),
         n_channels(layout.channels().size()),
         gain_calc(layout),
-        temp_mono(1, block_size),
-        temp(n_channels, block_size) {}
+        temp_mono(1, block_size) {}
 
   void setup_rendering_items(unsigned int fs,
                              const std::vector<std::shared_ptr<DirectSpeakersRenderingItem>> &rendering_items,
@@ -629,6 +911,7 @@ class DirectSpeakersRenderer {
     n_objects = rendering_items.size();
 
     gain_interpolators.clear();
+    active.clear();
     track_specs.clear();
 
     for (auto &ri : rendering_items) {
@@ -656,6 +939,7 @@ class DirectSpeakersRenderer {
 
       for (const auto &point : interp.get_end_points()) push_point(point);
 
+      active.emplace_back(gain_interp);
       gain_interpolators.push_back(std::move(gain_interp));
       track_specs.push_back(to_render_track_spec(ri->track_spec, channel_map));
     }
@@ -668,12 +952,16 @@ class DirectSpeakersRenderer {
 
   size_t delay() { return 0; }
 
+  void set_start(long int start) { block_start = start; }
+
   void process(const float *const *in, float *const *out) {
     zero_samples(out, n_channels, block_size);
+    long int block_end = block_start + static_cast<long int>(block_size);
     for (size_t i = 0; i < n_objects; i++) {
+      if (!active[i].active(block_start, block_end)) continue;
+
       render_track_spec(in, *temp_mono.ptrs(), block_size, track_specs[i]);
-      gain_interpolators[i].process(block_start, block_size, temp_mono.ptrs(), temp.ptrs());
-      add_samples(out, temp.ptrs(), n_channels, block_size);
+      gain_interpolators[i].mix(block_start, block_size, temp_mono.ptrs(), out);
     }
 
     block_start += static_cast<long int>(block_size);
@@ -687,15 +975,14 @@ class DirectSpeakersRenderer {
 
   std::vector<RenderTrackSpec> track_specs;
 
-  using InterpType = ear::dsp::LinearInterpVector;
-  using GainInterpolator = ear::dsp::GainInterpolator<InterpType>;
+  using GainInterpolator = GainRamp<std::vector<float>>;
 
   std::vector<GainInterpolator> gain_interpolators;
+  std::vector<ActiveRanges> active;
 
   ear::GainCalculatorDirectSpeakers gain_calc;
 
   Buffer temp_mono;
-  Buffer temp;
 };
 
 class HOARenderer {
@@ -703,18 +990,25 @@ class HOARenderer {
   HOARenderer(const ear::Layout &layout, size_t block_size_)
       : block_size(block_size_),
         n_channels(layout.channels().size()),
-        gain_calc(layout),
-        temp_out(n_channels, block_size) {}
+        gain_calc(layout) {}
 
   void setup_rendering_items(unsigned int fs, const std::vector<std::shared_ptr<HOARenderingItem>> &rendering_items,
                              const channel_map_t &channel_map) {
     n_objects = rendering_items.size();
 
     gain_interpolators.clear();
+    active.clear();
     track_specs.clear();
 
     size_t max_in_channels = 0;
 
+    // designing the decode matrix is relatively expensive, and many items
+    // often have the same format, so the gains are cached by the parameters
+    // used to calculate them
+    std::map<std::tuple<std::vector<int>, std::vector<int>, std::string, std::optional<double>>,
+             std::vector<std::vector<float>>>
+        cache;
+
     for (auto &ri : rendering_items) {
       if (ri->tracks.size() > max_in_channels) max_in_channels = ri->tracks.size();
 
@@ -741,13 +1035,22 @@ class HOARenderer {
       };
 
       for (auto &type_metadata : ri->type_metadata) {
-        gain_calc.calculate(to_hoatm(*ri, type_metadata), gains);
+        ear::HOATypeMetadata ear_tm = to_hoatm(*ri, type_metadata);
+        auto key = std::make_tuple(type_metadata.orders, type_metadata.degrees, type_metadata.normalization,
+                                   type_metadata.nfcRefDist);
+        auto [it, inserted] = cache.try_emplace(std::move(key));
+        if (inserted) {
+          it->second = zero_gains;
+          gain_calc.calculate(ear_tm, it->second);
+        }
+        gains = it->second;
 
         for (const auto &point : interp.get_interp_points(type_metadata)) push_point(point);
       }
 
       for (const auto &point : interp.get_end_points()) push_point(point);
 
+      active.emplace_back(gain_interp);
       gain_interpolators.push_back(std::move(gain_interp));
       track_specs.push_back(std::move(track_specs_for_ri));
     }
@@ -763,14 +1066,18 @@ class HOARenderer {
 
   size_t delay() { return 0; }
 
+  void set_start(long int start) { block_start = start; }
+
   void process(const float *const *in, float *const *out) {
     zero_samples(out, n_channels, block_size);
+    long int block_end = block_start + static_cast<long int>(block_size);
 
     for (size_t i = 0; i < n_objects; i++) {
+      if (!active[i].active(block_start, block_end)) continue;
+
       // flows:
       // in -> render track specs -> temp_in
-      // temp1 -> interpolator -> temp_out;
-      // temp_out -> add to out
+      // temp_in -> interpolator -> add to out
 
       auto &track_specs_for_obj = track_specs.at(i);
       auto &gain_interp = gain_interpolators.at(i);
@@ -778,8 +1085,7 @@ class HOARenderer {
       for (size_t in_channel = 0; in_channel < track_specs_for_obj.size(); in_channel++)
         render_track_spec(in, temp_in.channel_ptr(in_channel), block_size, track_specs_for_obj.at(in_channel));
 
-      gain_interp.process(block_start, block_size, temp_in.ptrs(), temp_out.ptrs());
-      add_samples(out, temp_out.ptrs(), n_channels, block_size);
+      gain_interp.mix(block_start, block_size, temp_in.ptrs(), out);
     }
 
     block_start += static_cast<long int>(block_size);
@@ -795,23 +1101,23 @@ class HOARenderer {
   using RenderTrackSpecs = std::vector<RenderTrackSpec>;
   std::vector<RenderTrackSpecs> track_specs;
 
-  using InterpType = ear::dsp::LinearInterpMatrix;
-  using GainInterpolator = ear::dsp::GainInterpolator<InterpType>;
+  using GainInterpolator = GainRamp<std::vector<std::vector<float>>>;
 
   std::vector<GainInterpolator> gain_interpolators;
+  std::vector<ActiveRanges> active;
 
   ear::GainCalculatorHOA gain_calc;
 
   Buffer temp_in;
-  Buffer temp_out;
 };
 
 class CombinedRenderer {
  public:
-  CombinedRenderer(const ear::Layout &layout, ear::dsp::block_convolver::Context &convolver_ctx, size_t block_size_)
+  CombinedRenderer(const ear::Layout &layout, ear::dsp::block_convolver::Context &convolver_ctx, size_t block_size_,
+                   size_t n_threads)
       : n_channels(layout.channels().size()),
         block_size(block_size_),
-        objects_renderer(layout, convolver_ctx, block_size),
+        objects_renderer(layout, convolver_ctx, block_size, n_threads),
         direct_speakers_renderer(layout, block_size),
         hoa_renderer(layout, block_size),
         objects_comp_delay(n_channels, objects_renderer.delay()),
@@ -849,6 +1155,14 @@ class CombinedRenderer {
 
   size_t delay() { return objects_renderer.delay(); }
 
+  /// set the position of the next block in samples, relative to the start
+  /// of the metadata timeline
+  void set_start(long int start) {
+    objects_renderer.set_start(start);
+    direct_speakers_renderer.set_start(start);
+    hoa_renderer.set_start(start);
+  }
+
   void process(const float *const *in, float *const *out) {
     // flows:
     // in -> object renderer -> temp1 -> add to out
@@ -885,16 +1199,18 @@ class CombinedRenderer {
 class RendererProcess : public StreamingAtomicProcess {
  public:
   RendererProcess(const std::string &name, const ear::Layout &layout, size_t block_size_,
-                  const SelectionOptionsId &options = {})
+                  const SelectionOptionsId &options = {}, size_t n_threads = 1)
       : StreamingAtomicProcess(name),
         selection_options(options),
         in_axml(add_in_port<DataPort<ADMData>>("in_axml")),
-        in_samples(add_in_port<StreamPort<InterleavedBlockPtr>>("in_samples")),
-        out_samples(add_out_port<StreamPort<InterleavedBlockPtr>>("out_samples")),
+        in_samples(add_in_port<StreamPort<PlanarBlockPtr>>("in_samples")),
+        out_samples(add_out_port<StreamPort<PlanarBlockPtr>>("out_samples")),
         block_size(block_size_),
         n_channels(layout.channels().size()),
         convolver_ctx(block_size, ear::get_fft_kiss<float>()),
-        renderer(layout, convolver_ctx, block_size) {}
+        renderer(layout, convolver_ctx, block_size, n_threads) {
+    in_samples->set_read_only();
+  }
 
   void initialise() override {
     auto adm = std::move(in_axml->get_value());
@@ -906,6 +1222,10 @@ class RendererProcess : public StreamingAtomicProcess {
 
     renderer.setup_rendering_items(sample_rate, result.items, adm.channel_map);
 
+    // the input may start part way through the timeline, e.g. if only part
+    // of a file was read
+    renderer.set_start(time_to_sample(adm.start, sample_rate));
+
     n_samples_processed = 0;
     has_input = false;
   }
@@ -931,16 +1251,31 @@ class RendererProcess : public StreamingAtomicProcess {
         always_assert(n_input_channels == info.channel_count, "number of samples changed while rendering");
       }
 
-      inputs.from_interleaved(*in_block);
-      outputs.resize(n_channels, info.sample_count);
-
-      vbs_adapter->process(info.sample_count, inputs.ptrs(), outputs.ptrs());
+      // the input channels are read directly from the block
+      in_ptrs.resize(n_input_channels);
+      for (size_t channel_i = 0; channel_i < n_input_channels; channel_i++)
+        in_ptrs[channel_i] = in_block->data() + channel_i * info.sample_count;
+
+      if (n_samples_processed >= delay_samples) {
+        // past the negative delay period, so render directly into the output
+        // block
+        BlockDescription out_info{info.sample_count, n_channels, sample_rate};
+        auto out_block = std::make_shared<PlanarSampleBlock>(out_info);
+        out_ptrs.resize(n_channels);
+        for (size_t channel_i = 0; channel_i < n_channels; channel_i++)
+          out_ptrs[channel_i] = out_block->data() + channel_i * info.sample_count;
+
+        vbs_adapter->process(info.sample_count, in_ptrs.data(), out_ptrs.data());
+        if (info.sample_count) out_samples->push(std::move(out_block));
+      } else {
+        outputs.resize(n_channels, info.sample_count);
+        vbs_adapter->process(info.sample_count, in_ptrs.data(), outputs.ptrs());
 
-      // only push output if the block extends past the negative delay period
-      if (n_samples_processed + info.sample_count > delay_samples) {
-        size_t start = n_samples_processed > delay_samples ? 0 : delay_samples - n_samples_processed;
-        auto out_block = std::make_shared<InterleavedSampleBlock>(outputs.to_interleaved(sample_rate, start));
-        out_samples->push(std::move(out_block));
+        // only push output if the block extends past the negative delay period
+        if (n_samples_processed + info.sample_count > delay_samples) {
+          size_t start = delay_samples - n_samples_processed;
+          out_samples->push(std::make_shared<PlanarSampleBlock>(outputs.to_planar(sample_rate, start)));
+        }
       }
 
       n_samples_processed += info.sample_count;
@@ -954,8 +1289,7 @@ class RendererProcess : public StreamingAtomicProcess {
 
         vbs_adapter->process(delay_samples, inputs.ptrs(), outputs.ptrs());
         size_t start = n_samples_processed > delay_samples ? 0 : delay_samples - n_samples_processed;
-        auto out_block = std::make_shared<InterleavedSampleBlock>(outputs.to_interleaved(sample_rate, start));
-        out_samples->push(std::move(out_block));
+        out_samples->push(std::make_shared<PlanarSampleBlock>(outputs.to_planar(sample_rate, start)));
       }
 
       out_samples->close();
@@ -975,8 +1309,8 @@ class RendererProcess : public StreamingAtomicProcess {
   size_t n_samples_processed = 0;
 
   DataPortPtr<ADMData> in_axml;
-  StreamPortPtr<InterleavedBlockPtr> in_samples;
-  StreamPortPtr<InterleavedBlockPtr> out_samples;
+  StreamPortPtr<PlanarBlockPtr> in_samples;
+  StreamPortPtr<PlanarBlockPtr> out_samples;
 
   size_t block_size;
   size_t n_channels;
@@ -986,13 +1320,16 @@ class RendererProcess : public StreamingAtomicProcess {
 
   std::unique_ptr<ear::dsp::VariableBlockSizeAdapter> vbs_adapter;
 
+  std::vector<const float *> in_ptrs;
+  std::vector<float *> out_ptrs;
+  /// silence fed in at the end, and output during the negative delay period
   Buffer inputs;
   Buffer outputs;
 };
 
 namespace eat::render {
 framework::ProcessPtr make_render(const std::string &name, const ear::Layout &layout, size_t block_size,
-                                  const SelectionOptionsId &options) {
-  return std::make_shared<RendererProcess>(name, layout, block_size, options);
+                                  const SelectionOptionsId &options, size_t n_threads) {
+  return std::make_shared<RendererProcess>(name, layout, block_size, options, n_threads);
 }
 }  // namespace eat::render
@@ -1,6 +1,9 @@
 #include "eat/render/render.hpp"
 
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <cmath>
 #include <ear/bs2051.hpp>
 
 #include "../utilities/check_samples.hpp"
@@ -8,6 +11,7 @@
 #include "eat/framework/evaluate.hpp"
 #include "eat/framework/process.hpp"
 #include "eat/process/adm_bw64.hpp"
+#include "eat/process/block.hpp"
 
 using namespace eat::framework;
 using namespace eat::process;
@@ -17,7 +21,8 @@ using namespace eat::utilities;
 // render in_fname and check the output is the same as reference_fname
 //
 // if rendered_fname is specified, the rendered samples will be written to it
-void run_test(const std::string &in_fname, const std::string &reference_fname, const std::string &rendered_fname = "") {
+void run_test(const std::string &in_fname, const std::string &reference_fname, const std::string &rendered_fname = "",
+              size_t n_threads = 1) {
   Graph g;
   const size_t block_size = 1024;
 
@@ -25,7 +30,7 @@ void run_test(const std::string &in_fname, const std::string &reference_fname, c
   auto read_reference = g.register_process(make_read_bw64("read_audio", reference_fname, block_size));
 
   auto layout = ear::getLayout("0+5+0");
-  auto renderer = make_render("renderer", layout, block_size);
+  auto renderer = make_render("renderer", layout, block_size, {}, n_threads);
   g.register_process(renderer);
 
   bool has_error = false;
@@ -44,7 +49,7 @@ void run_test(const std::string &in_fname, const std::string &reference_fname, c
   g.connect(read_reference->get_out_port("out_samples"), check->get_in_port("in_samples_ref"));
 
   if (rendered_fname.size()) {
-    auto write = g.register_process(make_write_bw64("write_rendered", rendered_fname));
+    auto write = g.register_process(make_write_bw64("write_rendered", rendered_fname, 0, SampleFormat::Float32));
     g.connect(renderer->get_out_port("out_samples"), write->get_in_port("in_samples"));
   }
 
@@ -73,6 +78,10 @@ TEST_CASE("render and check") {
   };
   // clang-format on
 
+  // objects are split between threads, which should not change the output
+  // beyond rounding
+  const size_t n_threads = GENERATE(1, 3);
+
   for (const std::string &sample : samples) {
     const std::string in_fname = test_file_path("render/" + sample + ".wav");
     const std::string reference_fname = test_file_path("render/" + sample + "_0_5_0.wav");
@@ -80,6 +89,59 @@ TEST_CASE("render and check") {
     // to write rendered results for comparison:
     // rendered_fname = test_file_path("render/" + sample + "_0_5_0_r.wav");
 
-    SECTION(sample) { run_test(in_fname, reference_fname, rendered_fname); }
+    SECTION(sample) { run_test(in_fname, reference_fname, rendered_fname, n_threads); }
+  }
+}
+
+/// render part of in_fname to 0+5+0, returning the interleaved output samples
+static std::vector<float> render_range(const std::string &in_fname, const TimeRange &range = {}) {
+  Graph g;
+  const size_t block_size = 1024;
+
+  auto read_adm = g.register_process(make_read_adm_bw64("read_adm", in_fname, block_size, 0, {}, range));
+  auto renderer = g.register_process(make_render("renderer", ear::getLayout("0+5+0"), block_size));
+  auto sink = g.add_process<InterleavedStreamingAudioSink>("sink");
+
+  g.connect(read_adm->get_out_port("out_samples"), renderer->get_in_port("in_samples"));
+  g.connect(read_adm->get_out_port("out_axml"), renderer->get_in_port("in_axml"));
+  g.connect(renderer->get_out_port("out_samples"), sink->get_in_port("in_samples"));
+
+  evaluate(g);
+  return sink->get();
+}
+
+TEST_CASE("render a time range") {
+  // an excerpt should be rendered with the metadata for its part of the
+  // programme timeline, so should match the same part of a full render; the
+  // range covers the changes in metadata at 12 and 24 samples in each file
+  const std::vector<std::string> samples = {
+      "object_delay", "interpolation_length", "timing_on_object", "silent_before_after_ds", "hoa_timing_on_object",
+  };
+  const size_t sample_rate = 48000;
+  const size_t start = 10;
+  const size_t length = 20;
+  const size_t n_channels = ear::getLayout("0+5+0").channels().size();
+
+  for (const std::string &sample : samples) {
+    SECTION(sample) {
+      const std::string in_fname = test_file_path("render/" + sample + ".wav");
+
+      auto full = render_range(in_fname);
+      TimeRange range{static_cast<double>(start) / sample_rate, static_cast<double>(length) / sample_rate};
+      auto excerpt = render_range(in_fname, range);
+
+      REQUIRE(full.size() >= (start + length) * n_channels);
+      REQUIRE(excerpt.size() == length * n_channels);
+
+      float max_error = 0.0f;
+      for (size_t i = 0; i < excerpt.size(); i++)
+        max_error = std::max(max_error, std::abs(excerpt[i] - full[start * n_channels + i]));
+      REQUIRE(max_error < 1e-6f);
+
+      // check that the excerpt is not trivially silent
+      float max_level = 0.0f;
+      for (float value : excerpt) max_level = std::max(max_level, std::abs(value));
+      REQUIRE(max_level > 0.0f);
+    }
   }
 }
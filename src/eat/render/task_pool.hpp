@@ -0,0 +1,113 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eat::render {
+
+/// runs batches of independent tasks on a fixed set of threads, for work
+/// which is split up the same way many times (e.g. for every block)
+///
+/// the thread calling run() takes part, so a pool of size 1 has no extra
+/// threads and just runs the tasks in order
+class TaskPool {
+ public:
+  explicit TaskPool(size_t n_threads) : size_(n_threads ? n_threads : 1) {
+    for (size_t i = 1; i < size_; i++) threads.emplace_back([this]() { worker(); });
+  }
+
+  TaskPool(const TaskPool &) = delete;
+  TaskPool &operator=(const TaskPool &) = delete;
+
+  ~TaskPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    start.notify_all();
+    for (auto &thread : threads) thread.join();
+  }
+
+  /// number of threads, including the one calling run()
+  size_t size() const { return size_; }
+
+  /// call task(i) for each i in [0, n_tasks), spread over the threads, and
+  /// wait for all calls to finish; if any throw, one of the exceptions is
+  /// rethrown once they have finished
+  void run(size_t n_tasks, const std::function<void(size_t)> &task) {
+    if (threads.empty() || n_tasks <= 1) {
+      for (size_t i = 0; i < n_tasks; i++) task(i);
+      return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    current_task = &task;
+    total = n_tasks;
+    next = 0;
+    remaining = n_tasks;
+    error = nullptr;
+    generation++;
+    start.notify_all();
+
+    run_tasks(lock);
+    done.wait(lock, [&] { return remaining == 0; });
+
+    current_task = nullptr;
+    if (error) std::rethrow_exception(error);
+  }
+
+ private:
+  void worker() {
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t seen = generation;
+    while (true) {
+      start.wait(lock, [&] { return stopping || generation != seen; });
+      if (stopping) return;
+      seen = generation;
+      run_tasks(lock);
+    }
+  }
+
+  /// take tasks from the current batch until there are none left; lock is
+  /// released while each task runs
+  void run_tasks(std::unique_lock<std::mutex> &lock) {
+    while (next < total) {
+      size_t i = next++;
+      auto &task = *current_task;
+
+      lock.unlock();
+      std::exception_ptr task_error;
+      try {
+        task(i);
+      } catch (...) {
+        task_error = std::current_exception();
+      }
+      lock.lock();
+
+      if (task_error && !error) error = task_error;
+      if (--remaining == 0) done.notify_all();
+    }
+  }
+
+  size_t size_;
+  std::vector<std::thread> threads;
+
+  std::mutex mutex;
+  std::condition_variable start;
+  std::condition_variable done;
+  bool stopping = false;
+  /// incremented for each call to run(), to wake the workers
+  size_t generation = 0;
+
+  const std::function<void(size_t)> *current_task = nullptr;
+  size_t total = 0;
+  size_t next = 0;
+  size_t remaining = 0;
+  std::exception_ptr error;
+};
+
+}  // namespace eat::render
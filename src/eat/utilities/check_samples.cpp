@@ -208,7 +208,10 @@ class CheckSamples : public StreamingAtomicProcess {
         aligner(2 /* channels */),
         rtol(rtol_),
         atol(atol_),
-        error_cb(std::move(error_cb_)) {}
+        error_cb(std::move(error_cb_)) {
+    in_samples_ref->set_read_only();
+    in_samples_test->set_read_only();
+  }
 
   void process() override {
     process_input(0, in_samples_ref);
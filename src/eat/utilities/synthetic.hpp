@@ -0,0 +1,237 @@
+#pragma once
+#include <adm/common_definitions.hpp>
+#include <adm/document.hpp>
+#include <adm/elements.hpp>
+#include <adm/utilities/object_creation.hpp>
+#include <adm/write.hpp>
+#include <bw64/bw64.hpp>
+#include <catch2/benchmark/catch_chronometer.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "eat/framework/evaluate.hpp"
+#include "eat/framework/process.hpp"
+#include "eat/process/adm_bw64.hpp"
+#include "eat/process/block.hpp"
+#include "eat/process/chna.hpp"
+
+namespace eat::utilities {
+
+/// shape of a synthetic ADM document made by make_synthetic_adm
+struct SyntheticADMOptions {
+  /// number of mono Objects items, each with one audioBlockFormat per
+  /// block_duration and a moving position
+  size_t n_objects = 0;
+  /// number of stereo DirectSpeakers items
+  size_t n_direct_speakers = 0;
+  /// number of 2nd-order HOA items, with 9 channels each
+  size_t n_hoa = 0;
+
+  std::chrono::milliseconds duration{10000};
+  std::chrono::milliseconds block_duration{100};
+
+  /// if not zero, each object only has a non-zero gain for this many
+  /// consecutive blocks, starting at a different time for each object
+  size_t active_blocks = 0;
+};
+
+/// number of channels used by a synthetic ADM document
+inline size_t synthetic_channel_count(const SyntheticADMOptions &options) {
+  return options.n_objects + 2 * options.n_direct_speakers + 9 * options.n_hoa;
+}
+
+/// make an ADM document with one programme and content containing the items
+/// described by options, with channels allocated in order (objects, then
+/// DirectSpeakers, then HOA)
+///
+/// only available in tests and benchmarks
+inline process::ADMData make_synthetic_adm(const SyntheticADMOptions &options) {
+  using namespace adm;
+
+  auto document = getCommonDefinitions();
+
+  auto programme = AudioProgramme::create(AudioProgrammeName("programme"));
+  auto content = AudioContent::create(AudioContentName("content"));
+  programme->addReference(content);
+
+  // track UIDs in channel order
+  std::vector<std::shared_ptr<AudioTrackUid>> track_uids;
+
+  for (size_t object_i = 0; object_i < options.n_objects; object_i++) {
+    auto holder = addSimpleObjectTo(document, "object " + std::to_string(object_i));
+    content->addReference(holder.audioObject);
+    track_uids.push_back(holder.audioTrackUid);
+
+    // each object circles the listener at a different rate
+    auto n_blocks = options.duration / options.block_duration;
+    for (std::chrono::milliseconds::rep block_i = 0; block_i < n_blocks; block_i++) {
+      float angle = static_cast<float>(block_i) * static_cast<float>(object_i + 1) * 3.0f;
+      float azimuth = std::fmod(angle, 360.0f) - 180.0f;
+      float elevation = static_cast<float>(object_i % 3) * 15.0f;
+      AudioBlockFormatObjects block{SphericalPosition{Azimuth{azimuth}, Elevation{elevation}},
+                                    Rtime{std::chrono::nanoseconds{options.block_duration * block_i}},
+                                    Duration{std::chrono::nanoseconds{options.block_duration}}};
+
+      if (options.active_blocks) {
+        auto first_active = static_cast<std::chrono::milliseconds::rep>(object_i * options.active_blocks) % n_blocks;
+        auto offset = (block_i - first_active + n_blocks) % n_blocks;
+        if (offset >= static_cast<std::chrono::milliseconds::rep>(options.active_blocks))
+          block.set(Gain::fromLinear(0.0));
+      }
+
+      holder.audioChannelFormat->add(block);
+    }
+  }
+
+  for (size_t ds_i = 0; ds_i < options.n_direct_speakers; ds_i++) {
+    auto pack = document->lookup(parseAudioPackFormatId("AP_00010002"));
+    auto object = AudioObject::create(AudioObjectName("direct speakers " + std::to_string(ds_i)));
+    content->addReference(object);
+    object->addReference(pack);
+
+    for (auto &track_format_id : {"AT_00010001_01", "AT_00010002_01"}) {
+      auto track_uid = AudioTrackUid::create();
+      track_uid->setReference(document->lookup(parseAudioTrackFormatId(track_format_id)));
+      track_uid->setReference(pack);
+      object->addReference(track_uid);
+      track_uids.push_back(track_uid);
+    }
+  }
+
+  for (size_t hoa_i = 0; hoa_i < options.n_hoa; hoa_i++) {
+    auto pack = document->lookup(parseAudioPackFormatId("AP_00040002"));
+    auto object = AudioObject::create(AudioObjectName("hoa " + std::to_string(hoa_i)));
+    content->addReference(object);
+    object->addReference(pack);
+
+    for (size_t channel_i = 0; channel_i < 9; channel_i++) {
+      std::string channel_id = "AC_0004000" + std::to_string(channel_i + 1);
+      auto channel = document->lookup(parseAudioChannelFormatId(channel_id));
+
+      auto track_uid = AudioTrackUid::create();
+      auto track = AudioTrackFormat::create(AudioTrackFormatName("track"), FormatDefinition::PCM);
+      auto stream = AudioStreamFormat::create(AudioStreamFormatName("stream"), FormatDefinition::PCM);
+      track_uid->setReference(pack);
+      track_uid->setReference(track);
+      track->setReference(stream);
+      stream->setReference(channel);
+
+      object->addReference(track_uid);
+      track_uids.push_back(track_uid);
+    }
+  }
+
+  document->add(programme);
+
+  process::channel_map_t channel_map;
+  for (size_t channel = 0; channel < track_uids.size(); channel++)
+    channel_map[track_uids[channel]->get<AudioTrackUidId>()] = channel;
+
+  return {std::move(document), std::move(channel_map)};
+}
+
+/// make n_frames of interleaved noise with n_channels channels
+inline std::vector<float> make_synthetic_samples(size_t n_channels, size_t n_frames, uint32_t seed = 1) {
+  std::vector<float> samples(n_channels * n_frames);
+  uint32_t state = seed;
+  for (auto &sample : samples) {
+    state = state * 1103515245u + 12345u;
+    sample = 0.2f * (static_cast<float>(state >> 8) / static_cast<float>(1u << 24) - 0.5f);
+  }
+  return samples;
+}
+
+/// write samples and (if adm is not null) the ADM data to a BW64 file
+inline void write_synthetic_bw64(const std::string &path, const std::vector<float> &samples, size_t n_channels,
+                                 unsigned int sample_rate, const process::ADMData *adm = nullptr) {
+  auto file = bw64::writeFile(path, static_cast<uint16_t>(n_channels), sample_rate, 24);
+  file->write(samples.data(), samples.size() / n_channels);
+
+  if (adm) {
+    auto document = adm->document.read();
+    std::ostringstream axml;
+    adm::writeXml(axml, document);
+    file->setAxmlChunk(std::make_shared<bw64::AxmlChunk>(axml.str()));
+    file->setChnaChunk(std::make_shared<bw64::ChnaChunk>(process::make_chna(*document, adm->channel_map)));
+  }
+}
+
+/// a process which discards input samples, counting them
+///
+/// ports:
+/// - in_samples (StreamPort<InterleavedBlockPtr>) : input samples
+class DiscardSamples : public framework::StreamingAtomicProcess {
+ public:
+  explicit DiscardSamples(const std::string &name)
+      : StreamingAtomicProcess(name),
+        in_samples(add_in_port<framework::StreamPort<process::InterleavedBlockPtr>>("in_samples")) {
+    in_samples->set_read_only();
+  }
+
+  void process() override {
+    while (in_samples->available()) n_frames += in_samples->pop().read()->info().sample_count;
+  }
+
+  size_t n_frames = 0;
+
+ private:
+  framework::StreamPortPtr<process::InterleavedBlockPtr> in_samples;
+};
+
+/// benchmark running graphs made by make_graph, for use in BENCHMARK_ADVANCED
+///
+/// a graph is made and planned for each run before measuring, so that only
+/// the time taken to run the plans is included; this is intended for graphs
+/// which take much longer to run than the clock resolution, for which Catch
+/// only does one run per sample
+template <typename MakeGraph>
+void measure_run(Catch::Benchmark::Chronometer &meter, MakeGraph &&make_graph) {
+  std::vector<framework::Plan> plans;
+  for (int i = 0; i < meter.runs(); i++) plans.push_back(framework::plan(make_graph()));
+
+  meter.measure([&](int i) { plans[static_cast<size_t>(i)].run(); });
+}
+
+/// measures the peak memory used by the process while something runs,
+/// relative to the memory in use when measurement started
+///
+/// this uses the peak resident set size, which can only be reset on Linux; on
+/// other platforms measure() returns std::nullopt
+class PeakMemory {
+ public:
+  PeakMemory() {
+#ifdef __linux__
+    // writing 5 to clear_refs resets the peak resident set size
+    std::ofstream("/proc/self/clear_refs") << "5";
+    baseline = read_status_kib("VmRSS:");
+#endif
+  }
+
+  /// peak memory used since construction, in bytes
+  std::optional<size_t> measure() const {
+    auto peak = read_status_kib("VmHWM:");
+    if (!peak || !baseline) return std::nullopt;
+    return *peak > *baseline ? (*peak - *baseline) * 1024 : 0;
+  }
+
+ private:
+  static std::optional<size_t> read_status_kib([[maybe_unused]] const std::string &field) {
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+      if (line.rfind(field, 0) == 0) return std::stoul(line.substr(field.size()));
+#endif
+    return std::nullopt;
+  }
+
+  std::optional<size_t> baseline;
+};
+
+}  // namespace eat::utilities